@@ -9,111 +9,29 @@
 #include <cstdlib>
 #include <cstring>
 #include <cassert>
-#include <queue>
-#include <stack>
 #include <fstream>
+#include <chrono>
+#include <algorithm>
 
 #include "tinyxml2.h"
 #include "dist.h"
 #include "graph.h"
 #include "osm.h"
+#include "mapdata.h"
+#include "query.h"
+#include "engine.h"
+#include "server.h"
+#include "reload.h"
+#include "osmchange.h"
+#include "stats.h"
+#include "trace.h"
+#include "footprint.h"
+#include "routes.h"
 
 
 using namespace std;
 using namespace tinyxml2;
 
-const double INF = numeric_limits<double>::max();
-
-// prioritize class used for priority queue ordering
-class prioritize {
-    public:
-        bool operator()(const pair<long long, double>& p1, const pair<long long, double>& p2) const
-        {
-            return p1.second > p2.second; 
-        }
-};
-
-/*fucntion finds the buildings that matches the names or abbreviations given by the user
-if a building is found, its corresponding BuildingInfo parameter is changed
-Takes 7 parameters:
-    1. Buildings: a vector of buildings to search from
-    2, 3. person1Building, person2Building: the names or abbreviations given
-    4, 5. building1, building2: the BuildingInfo structs storing the found buildings
-    6, 7. build1Found, build2Found: flag variables keeping track if a building is found
-No returns*/
-void findBuildings(const vector<BuildingInfo>& Buildings, 
-                   const string person1Building, const string person2Building, 
-                   BuildingInfo& building1, BuildingInfo& building2,
-                   bool& build1Found, bool& build2Found){
-
-    // first, attempt to search by abbreviation
-    for (BuildingInfo building : Buildings){
-
-        if (building.Abbrev == person1Building && !build1Found){
-            building1 = building;
-            build1Found = true;
-        }
-
-        if (building.Abbrev == person2Building && !build2Found){
-            building2 = building;
-            build2Found = true;
-        }
-    }
-
-    //if either building could not be found via its abbreviation, search by partial or full name
-    if (!build1Found || !build2Found){
-
-        for (BuildingInfo building : Buildings){
-
-            if (building.Fullname.find(person1Building) != string::npos && !build1Found){
-                building1 = building;
-                build1Found = true;
-            }
-
-            if (building.Fullname.find(person2Building) != string::npos && !build2Found){
-                building2 = building;
-                build2Found = true;
-            }
-        }
-    }
-}
-
-/*function finds the destination/center building of two buildings
-Takes 4 parameters:
-    1. Buildings: a vector of buildings to search from
-    2, 3. building1, building2: the starting buildings
-    4. usedBuildings: a set of buildings already chosen and tried as the destination
-returns the destination building*/
-BuildingInfo findDestinationBuilding(const vector<BuildingInfo>& Buildings, 
-                                     const BuildingInfo& building1, const BuildingInfo& building2,
-                                     set<string>& usedBuildings){
-
-    // calculates the center between building1 and building2
-    Coordinates center = centerBetween2Points(building1.Coords.Lat, building1.Coords.Lon, building2.Coords.Lat, building2.Coords.Lon);
-
-    // searches through Buildings to find the building closest to the center
-    BuildingInfo centerBuilding = Buildings.at(0);
-    double closestDist = distBetween2Points(centerBuilding.Coords.Lat, centerBuilding.Coords.Lon, center.Lat, center.Lon);
-    double dist;
-    for (const BuildingInfo& building : Buildings){
-
-        // buildings already used are skipped
-        if (usedBuildings.count(building.Fullname)) continue;
-
-        dist = distBetween2Points(building.Coords.Lat, building.Coords.Lon, center.Lat, center.Lon);
-        
-        if (dist < closestDist){
-            centerBuilding = building;
-            closestDist = dist;
-        }
-        
-    }
-
-    usedBuildings.emplace(centerBuilding.Fullname);
-    return centerBuilding;
-    
-}
-
 /*function outputs the building informations
 Takes 3 parameters:
     1 - 3. building1, building2, dest: the 3 buildings 
@@ -133,200 +51,130 @@ void outputBuildings(const BuildingInfo& building1, const BuildingInfo& building
         
 }
 
-/*function finds the closest nodes on a footway to each of the 2 starting buildings and destination building
-Takes 6 parameters:
-    1. Footways: the vector of footways
-    2. allNodes: the map of all nodes on the map/graph
-    3 - 5. building1, building2, center: the 3 buildings
-    6. closestNodes: the vector to store the 3 nodes
-No returns*/
-void findNearestNodes(vector<FootwayInfo>& Footways, map<long long, Coordinates>& allNodes,
-                      const BuildingInfo building1, const BuildingInfo building2, const BuildingInfo center, 
-                      vector<long long>& closestNodes){
-
-    long long closestNode1, closestNode2, closestNode3;
-    double closestDist1 = distBetween2Points(building1.Coords.Lat, building1.Coords.Lon, allNodes[Footways.at(0).Nodes.at(0)].Lat, allNodes[Footways.at(0).Nodes.at(0)].Lon),
-           closestDist2 = distBetween2Points(building2.Coords.Lat, building2.Coords.Lon, allNodes[Footways.at(0).Nodes.at(0)].Lat, allNodes[Footways.at(0).Nodes.at(0)].Lon),
-           closestDist3 = distBetween2Points(center.Coords.Lat, center.Coords.Lon, allNodes[Footways.at(0).Nodes.at(0)].Lat, allNodes[Footways.at(0).Nodes.at(0)].Lon);
-
-    double dist;
-
-    // finds the closest node on a footway from each building
-    for (const FootwayInfo& way : Footways){
-
-        for (const long long& node : way.Nodes){
-
-            dist = distBetween2Points(building1.Coords.Lat, building1.Coords.Lon, allNodes[node].Lat, allNodes[node].Lon);
-            if (dist < closestDist1){
-                closestDist1 = dist;
-                closestNode1 = node;
-            }
-
-            dist = distBetween2Points(building2.Coords.Lat, building2.Coords.Lon, allNodes[node].Lat, allNodes[node].Lon);
-            if (dist < closestDist2){
-                closestDist2 = dist;
-                closestNode2 = node;
-            }
-
-            dist = distBetween2Points(center.Coords.Lat, center.Coords.Lon, allNodes[node].Lat, allNodes[node].Lon);
-            if (dist < closestDist3){
-                closestDist3 = dist;
-                closestNode3 = node;
-            }
-        }
-    
-    }
-
-    closestNodes.push_back(closestNode1);
-    closestNodes.push_back(closestNode2);
-    closestNodes.push_back(closestNode3);
-}
-
 /*function outputs the nodes information
 Takes 2 parameters:
     1. closestNodes: the vector storing the closest nodes
-    2. Nodes: the map storing information on each node
+    2. Nodes: the position of each node
 No returns*/
-void outputClosestNodes(vector<long long>& closestNodes, map<long long, Coordinates>& Nodes){
+void outputClosestNodes(const vector<long long>& closestNodes, const NodeStore& Nodes){
+
+    int node1 = Nodes.indexOf(closestNodes.at(0));
+    int node2 = Nodes.indexOf(closestNodes.at(1));
+    int destNode = Nodes.indexOf(closestNodes.at(2));
 
     cout << "Nearest P1 node:\n"
          << " " << closestNodes.at(0) << endl
-         << " (" << Nodes[closestNodes.at(0)].Lat << ", " << Nodes[closestNodes.at(0)].Lon << ")\n";
+         << " (" << Nodes.latOf(node1) << ", " << Nodes.lonOf(node1) << ")\n";
 
     cout << "Nearest P2 node:\n"
          << " " << closestNodes.at(1) << endl
-         << " (" << Nodes[closestNodes.at(1)].Lat << ", " << Nodes[closestNodes.at(1)].Lon << ")\n";
+         << " (" << Nodes.latOf(node2) << ", " << Nodes.lonOf(node2) << ")\n";
 
     cout << "Nearest destination node:\n"
          << " " << closestNodes.at(2) << endl
-         << " (" << Nodes[closestNodes.at(2)].Lat << ", " << Nodes[closestNodes.at(2)].Lon << ")\n";
+         << " (" << Nodes.latOf(destNode) << ", " << Nodes.lonOf(destNode) << ")\n";
 
 }
 
-/*function performs Dijkstra's algorithm to find the shortest path between 2 nodes
-Takes 4 parameters:
-    1. start: the node the search starts from
-    2. graph: the graph being traversed
-    3. predecessors: the map to store the predecessors of each node
-    4. distance: the map the store the shortest distance each node is from the start
+/*function prints out the path
+Takes 1 parameters:
+    path: the vector storing the path, from start to destination
 No returns*/
-void dijkstra(const long long& start, const graph<long long, double>& graph, 
-              map<long long, long long>& predecessors, map<long long, double>& distance){
-
-    // first intitalizes the distance of each node to INF, and pushes them to the priority queue
-    vector<long long> vertices = graph.getVertices();
-    priority_queue<pair<long long, double>, vector<pair<long long, double>>, prioritize> unvisitedQueue;
-    for (long long& vertex : vertices){
-        distance[vertex] = INF;
-        predecessors[vertex] = -1;
-        unvisitedQueue.push(pair(vertex, INF));
-    }
-    
-    // sets start's distance away from start to 0 and pushses it to the priority queue
-    distance[start] = 0;
-    unvisitedQueue.push(pair(start, 0));
-
-    set<long long> visited;
-    
-    while (!unvisitedQueue.empty()){
-
-        //dequeues off the first node in the queue
-        pair<long long, double> current = unvisitedQueue.top();
-        unvisitedQueue.pop();
-
-        // checks if the node should be checked
-        if (current.second == INF){
-            break;
-        }
-        else if (visited.count(current.first)){
-            continue;
-        }
-
-        visited.emplace(current.first);
-        
-        set<long long> neighbors = graph.neighbors(current.first);
+void printPath(const vector<long long>& path){
 
-        double currentDistance = INF;
+    cout << "Path: " << path.front();
 
-        // visits every neighboring node and checks if a new shortest distance from start is found 
-        for (const long long& vertex : neighbors){
+    for (size_t i = 1; i < path.size(); i++){
+        cout << "->" << path[i];
+    }
 
-            graph.getWeight(current.first, vertex, currentDistance);
-            double currentTotalDistance = distance[vertex];
-            double altTotalDistance = current.second + currentDistance;
+    cout << endl;
 
-            if (altTotalDistance < currentTotalDistance){
-                distance[vertex] = altTotalDistance;
-                predecessors[vertex] = current.first;
-                unvisitedQueue.push(pair(vertex, altTotalDistance));
-            }
+}
 
-        }
+/*function outputs the result of one query
+Takes 2 parameters:
+    1. result: the result of the query
+    2. Nodes: the position of each node
+No returns*/
+void outputMeetingResult(const MeetingResult& result, const NodeStore& Nodes){
 
+    if (!result.build1Found){
+        cout << "Person 1's building not found\n";
+        return;
+    }
+    else if (!result.build2Found){
+        cout << "Person 2's building not found\n";
+        return;
     }
 
-} 
+    // outputs the buildings and nearest nodes to said buildings
+    outputBuildings(result.building1, result.building2, result.destination);
+    cout << endl;
+    outputClosestNodes(result.nearestNodes, Nodes);
 
-/*function builds the path based on the results of the Dijkstra's algorithm results for predecessors and distance
-Takes 5 parameters:
-    1. destination: the destination for the path
-    2. path: the stack to store the path
-    3. totDistance: if a path is possible, its value is changed to the total distance of that path
-    4. predecessors: the map storing the predecessors of each node
-    5. distance: the map storing the distances of each node from the start
-Returns a boolean value if a path is possible*/
-bool buildPath(long long& destination, stack<long long>& path, double& totDistance, 
-               map<long long, long long>& predecessors, 
-               map<long long, double>& distance){
+    // messages for when a path is found or not
+    if (!result.reachable){
+        cout << "\nSorry, destination unreachable.\n";
+    }
+    else{
+        cout << "\nPerson 1's distance to dest: " << result.path1Distance << " miles\n";
+        printPath(result.path1);
 
-    totDistance = distance[destination];
+        cout << "\nPerson 2's distance to dest: " << result.path2Distance << " miles\n";
+        printPath(result.path2);
+    }
+}
 
-    // checks if a path is possible by checking if totDistance is equal to INF
-    if (totDistance == INF) return false;
+/*function outputs how many footways of each class were read, when there is more than one
+Takes 1 parameter:
+    data: the loaded map
+No returns*/
+void outputWayClasses(const MapData& data){
 
-    path.push(destination);
-    long long predNode = predecessors[destination];
+    vector<int> counts(data.Ways.numClasses(), 0);
+    for (const FootwayInfo& footway : data.Footways){
+        counts[footway.Class]++;
+    }
 
-    // pushes to the path stack to build the actual path
-    while (predNode != -1){
-        path.push(predNode);
-        predNode = predecessors[predNode];
+    if (count_if(counts.begin(), counts.end(), [](int n){ return n > 0; }) < 2){
+        return;
     }
 
-    return true;
+    for (int c = 0; c < data.Ways.numClasses(); c++){
+        if (counts[c] > 0) cout << "  highway=" << data.Ways.nameOf(c) << ": " << counts[c] << endl;
+    }
 }
 
-/*function prints out the path
-Takes 1 parameters:
-    path: the stack storing the ath
+/*function outputs the alternative routes between two buildings
+Takes 1 parameter:
+    result: the result of the routes query
 No returns*/
-void printPath(stack<long long> path){
+void outputRoutes(const RoutesResult& result){
 
-    cout << "Path: " << path.top();
-    path.pop();
-
-    while (!path.empty()){
-        cout << "->" << path.top();
-        path.pop();
+    if (result.routes.empty()){
+        return;
     }
 
-    cout << endl;
+    cout << "\nRoutes between " << result.building1.Fullname << " and " << result.building2.Fullname << ":\n";
 
+    for (size_t i = 0; i < result.routes.size(); i++){
+        cout << "Route " << i + 1 << ": " << result.routes[i].distance << " miles\n";
+        printPath(result.routes[i].path);
+    }
 }
 
 /*main driver function for program.
 reads in inputs for the 2 starting buildings, finds their center, and finds a path to the center
-Takes 4 parameters:
-    1. Nodes: the map storing all the nodes on the graph
-    2. Footways: the vector of all footways
-    3. Buildings: the vector of all buildings
-    4. G: the graph representing the map
+Takes 3 parameters:
+    1. data: the loaded map
+    2. tracer: if not null, each query is traced into it and its stages are printed
+    3. alternatives: if above 0, up to this many routes between the two buildings are printed too
 No returns*/
-void application(
-    map<long long, Coordinates>& Nodes, vector<FootwayInfo>& Footways,
-    vector<BuildingInfo>& Buildings, graph<long long, double>& G) {
+void application(const MapData& data, QueryTracer* tracer, int alternatives) {
 
     string person1Building, person2Building;
+    SearchWorkspace ws;
 
     // reads in starting buildings
     cout << endl;
@@ -337,179 +185,362 @@ void application(
         cout << "Enter person 2's building (partial name or abbreviation)> ";
         getline(cin, person2Building);
 
-        BuildingInfo building1, building2;
-        bool build1Found = false, build2Found = false;
-
-        //finds starting buildings
-        findBuildings(Buildings, person1Building, person2Building, building1, building2, build1Found, build2Found);
+        if (tracer){
+            QueryTrace trace(person1Building, person2Building);
+            MeetingResult result = findMeetingPoint(data, person1Building, person2Building, ws, nullptr, &trace);
+            tracer->record(trace);
 
-        if (!build1Found){
-            cout << "Person 1's building not found\n";
-        }
-        else if (!build2Found){
-            cout << "Person 2's building not found\n";
+            outputMeetingResult(result, data.Nodes);
+            cout << endl;
+            printQueryTrace(cout, trace);
         }
         else{
-            set<string> usedBuildings;
-            BuildingInfo destination;
-            vector<long long> nearestNodes;
-
-            map<long long, long long> predecessors;
-            map<long long, double> distance; 
-            stack<long long> path1, path2;
-            bool reachable = false, destReach1 = false, destReach2 = false;
-            double path1Distance = INF, path2Distance = INF;
-
-            // do-while loop to repeatedly find a destination building that is reachable from the two starting buildings
-            do{
-                
-                nearestNodes.clear();
-                destination = findDestinationBuilding(Buildings, building1, building2, usedBuildings);
-                findNearestNodes(Footways, Nodes, building1, building2, destination, nearestNodes);
-
-                dijkstra(nearestNodes.at(0), G, predecessors, distance);
-                stack<long long> reachablePath;
-                double reachableDistance = INF;
-                reachable = buildPath(nearestNodes.at(1), reachablePath, reachableDistance, predecessors, distance);
-
-                //if a path from building1 to building2 does not exist, immediately stop searching
-                if (!reachable) break;
-                predecessors.clear();
-                distance.clear();
-
-                dijkstra(nearestNodes.at(0), G, predecessors, distance);
-                destReach1 = buildPath(nearestNodes.at(2), path1, path1Distance, predecessors, distance);
-                if (!destReach1) continue;
-                predecessors.clear();
-                distance.clear();
-
-                dijkstra(nearestNodes.at(1), G, predecessors, distance);
-                destReach2 = buildPath(nearestNodes.at(2), path2, path2Distance, predecessors, distance);
-                if (!destReach2) continue;
-                predecessors.clear();
-                distance.clear();
-
-            } while (!destReach1 && !destReach2);
-            
-            // outputs the buildings and nearest nodes to said buildings
-            outputBuildings(building1, building2, destination);
-            cout << endl;
-            outputClosestNodes(nearestNodes, Nodes);
-
-            // messages for when a path is found or not
-            if (!reachable){
-                cout << "\nSorry, destination unreachable.\n";
-            }
-            else{
-                cout << "\nPerson 1's distance to dest: " << path1Distance << " miles\n";
-                printPath(path1);
-
-                cout << "\nPerson 2's distance to dest: " << path2Distance << " miles\n";
-                printPath(path2);
-            }
+            MeetingResult result = findMeetingPoint(data, person1Building, person2Building, ws);
+            outputMeetingResult(result, data.Nodes);
+        }
+
+        if (alternatives > 0){
+            RouteOptions options;
+            options.k = alternatives;
+            outputRoutes(findBuildingRoutes(data, person1Building, person2Building, options, ws));
         }
-        
 
         cout << endl;
         cout << "Enter person 1's building (partial name or abbreviation), or #> ";
         getline(cin, person1Building);
-    }    
+    }
 }
 
-int main() {
-    graph<long long, double> G;
+/*function outputs the counters of a result cache
+Takes 1 parameter:
+    stats: the cache's counters
+No returns*/
+void outputCacheStats(const CacheStats& stats){
 
-    // maps a Node ID to it's coordinates (lat, lon)
-    map<long long, Coordinates>  Nodes;
-    // info about each footway, in no particular order
-    vector<FootwayInfo>          Footways;
-    // info about each building, in no particular order
-    vector<BuildingInfo>         Buildings;
-    XMLDocument                  xmldoc;
+    cout << "Cache hits: " << stats.hits << ", misses: " << stats.misses
+         << " (hit rate " << stats.hitRate() * 100 << "%)" << endl;
+    cout << "Cache entries: " << stats.entries << " of " << stats.maxEntries
+         << ", " << stats.bytes << " bytes, " << stats.evictions << " evictions" << endl;
+}
+
+/*batch driver: answers every query in a file using the thread pool
+each line of the file holds person 1's and person 2's buildings, separated by a tab
+Takes 5 parameters:
+    1. data: the loaded map
+    2. queryFilename: the file of queries
+    3. numThreads: the number of worker threads, 0 for one per hardware thread
+    4. cacheEntries: the size of the result cache, 0 for no cache
+    5. tracer: if not null, every query is traced into it
+Returns false if the file could not be read*/
+bool batchApplication(shared_ptr<const MapData> data, const string& queryFilename, unsigned numThreads, size_t cacheEntries,
+                      QueryTracer* tracer) {
+
+    ifstream queryFile(queryFilename);
+    if (!queryFile){
+        cout << "**Error: unable to open query file '" << queryFilename << "'." << endl;
+        return false;
+    }
+
+    vector<pair<string, string>> queries;
+    string line;
+    while (getline(queryFile, line)){
+
+        size_t tab = line.find('\t');
+        if (line.empty() || tab == string::npos) continue;
+
+        queries.push_back(pair(line.substr(0, tab), line.substr(tab + 1)));
+    }
+
+    QueryEngine engine(data, numThreads, cacheEntries);
+    engine.setTracer(tracer);
+
+    auto start = chrono::steady_clock::now();
+    vector<MeetingResult> results = engine.runBatch(queries);
+    auto end = chrono::steady_clock::now();
+
+    for (size_t i = 0; i < results.size(); i++){
+        cout << "Query " << i + 1 << ": " << queries[i].first << " / " << queries[i].second << endl;
+        outputMeetingResult(results[i], data->Nodes);
+        cout << endl;
+    }
+
+    double ms = chrono::duration<double, milli>(end - start).count();
+    cout << "# of queries: " << queries.size() << endl;
+    cout << "# of threads: " << engine.numWorkers() << endl;
+    cout << "Batch time: " << ms << " ms" << endl;
+
+    if (engine.current()->cache){
+        outputCacheStats(engine.current()->cache->stats());
+    }
+
+    return true;
+}
+
+/*function outputs what applying a change file did, next to the time a full load took
+Takes 3 parameters:
+    1. filename: the change file
+    2. stats: what the change did
+    3. loadMs: how long loading the whole map took
+No returns*/
+void outputChangeStats(const string& filename, const OsmChangeStats& stats, double loadMs){
+
+    cout << "Applied '" << filename << "' in " << stats.parseMs + stats.applyMs + stats.rebuildMs << " ms"
+         << " (parse " << stats.parseMs << ", apply " << stats.applyMs << ", rebuild " << stats.rebuildMs << ")"
+         << "; the full map load took " << loadMs << " ms" << endl;
+    cout << " nodes: " << stats.nodesCreated << " created, " << stats.nodesModified << " modified, "
+         << stats.nodesDeleted << " deleted" << endl;
+    cout << " footways: " << stats.footwaysCreated << " created, " << stats.footwaysModified << " modified, "
+         << stats.footwaysDeleted << " deleted" << endl;
+    cout << " buildings: " << stats.buildingsCreated << " created, " << stats.buildingsModified << " modified, "
+         << stats.buildingsDeleted << " deleted" << endl;
+    cout << " edges: " << stats.edgesAdded << " added, " << stats.edgesRemoved << " removed, "
+         << stats.edgesReweighted << " reweighted; " << stats.skipped << " skipped" << endl;
+}
+
+/*Usage: application.exe [--map FILE] [--batch FILE | --serve SOCKET] [--threads N] [--cache N] [--precompute]
+                        [--distance cosines|haversine|planar|auto] [--distance-error E] [--watch SECONDS]
+                        [--changes FILE.osc]... [--stats] [--stats-json FILE] [--latency] [--trace-json FILE]
+                        [--memory] [--alternatives K] [--highways VALUE[:FACTOR],...]
+without --map the map filename is read from the console, and without --batch or
+--serve queries are read interactively. --cache keeps up to N meeting results
+for batch and server mode, and --precompute builds a shortest-path tree from
+every building after loading. --distance picks the distance model for edge
+weights and nearest nodes; auto takes the cheapest one within a relative error
+of E (default 0.001). In server mode, --watch checks the map file every SECONDS
+seconds and reloads it in the background when it changes. Each --changes file is
+an osmChange document applied to the map after loading, in order. --latency
+prints percentiles of each query stage at the end, and each query's stages in
+interactive mode; --trace-json writes every stage as a Chrome trace event.
+--memory prints the bytes held by each loaded structure and the resident set
+after each load phase. --alternatives prints, in interactive mode, up to K
+routes between the two buildings that differ from each other by at least 30%
+of their length. --highways replaces the table of highway values read as
+footways, each with an optional speed factor relative to a footway; the default is
+footway,path,pedestrian,living_street,corridor,track:0.9,steps:0.5*/
+int main(int argc, char* argv[]) {
+
+    auto                         data = make_shared<MapData>();
+
+    string filename, batchFilename, socketPath;
+    unsigned numThreads = 0;
+    size_t cacheEntries = 0;
+    bool haveFilename = false, precompute = false;
+    DistanceModel model = DistanceModel::SphericalCosines;
+    double maxDistanceError = 1e-3;
+    double watchSeconds = 0;
+    vector<string> changeFilenames;
+    bool printStatsAtEnd = false;
+    string statsFilename;
+    bool printLatencyAtEnd = false;
+    string traceFilename;
+    bool printMemory = false;
+    int alternatives = 0;
+    WayFilter ways;
+
+    for (int i = 1; i < argc; i++){
+        string arg = argv[i];
+
+        if (arg == "--map" && i + 1 < argc){
+            filename = argv[++i];
+            haveFilename = true;
+        }
+        else if (arg == "--batch" && i + 1 < argc){
+            batchFilename = argv[++i];
+        }
+        else if (arg == "--serve" && i + 1 < argc){
+            socketPath = argv[++i];
+        }
+        else if (arg == "--threads" && i + 1 < argc){
+            numThreads = static_cast<unsigned>(atoi(argv[++i]));
+        }
+        else if (arg == "--cache" && i + 1 < argc){
+            cacheEntries = static_cast<size_t>(atol(argv[++i]));
+        }
+        else if (arg == "--precompute"){
+            precompute = true;
+        }
+        else if (arg == "--distance" && i + 1 < argc && parseDistanceModel(argv[i + 1], model)){
+            i++;
+        }
+        else if (arg == "--distance-error" && i + 1 < argc){
+            maxDistanceError = atof(argv[++i]);
+        }
+        else if (arg == "--watch" && i + 1 < argc){
+            watchSeconds = atof(argv[++i]);
+        }
+        else if (arg == "--changes" && i + 1 < argc){
+            changeFilenames.push_back(argv[++i]);
+        }
+        else if (arg == "--stats"){
+            printStatsAtEnd = true;
+        }
+        else if (arg == "--stats-json" && i + 1 < argc){
+            statsFilename = argv[++i];
+        }
+        else if (arg == "--latency"){
+            printLatencyAtEnd = true;
+        }
+        else if (arg == "--trace-json" && i + 1 < argc){
+            traceFilename = argv[++i];
+        }
+        else if (arg == "--memory"){
+            printMemory = true;
+        }
+        else if (arg == "--alternatives" && i + 1 < argc){
+            alternatives = atoi(argv[++i]);
+        }
+        else if (arg == "--highways" && i + 1 < argc && WayFilter::parse(argv[i + 1], ways)){
+            i++;
+        }
+        else{
+            cout << "Usage: " << argv[0] << " [--map FILE] [--batch FILE | --serve SOCKET] [--threads N] [--cache N] [--precompute]"
+                 << " [--distance cosines|haversine|planar|auto] [--distance-error E] [--watch SECONDS] [--changes FILE.osc]..."
+                 << " [--stats] [--stats-json FILE] [--latency] [--trace-json FILE] [--memory] [--alternatives K]"
+                 << " [--highways VALUE[:FACTOR],...]" << endl;
+            return 0;
+        }
+    }
 
     cout << "** Navigating UIC open street map **" << endl;
     cout << endl;
     cout << std::setprecision(8);
 
     string def_filename = "map.osm";
-    string filename;
 
-    cout << "Enter map filename> ";
-    getline(cin, filename);
+    if (!haveFilename){
+        cout << "Enter map filename> ";
+        getline(cin, filename);
+    }
 
     if (filename == "") {
         filename = def_filename;
     }
 
     //
-    // Load XML-based map file
+    // Load the map and build the footway graph
     //
-    if (!LoadOpenStreetMap(filename, xmldoc)) {
+    auto loadStart = chrono::steady_clock::now();
+    MemoryPhases loadPhases;
+
+    data->Ways = ways;
+
+    if (!loadMapData(filename, *data, model, maxDistanceError, printMemory ? &loadPhases : nullptr)) {
         cout << "**Error: unable to load open street map." << endl;
         cout << endl;
         return 0;
     }
 
-    //
-    // Read the nodes, which are the various known positions on the map:
-    //
-    int nodeCount = ReadMapNodes(xmldoc, Nodes);
+    double loadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - loadStart).count();
 
     //
-    // Read the footways, which are the walking paths:
+    // Apply map updates
     //
-    int footwayCount = ReadFootways(xmldoc, Footways);
+    for (const string& changeFilename : changeFilenames){
+        OsmChangeStats changeStats;
 
-    //
-    // Read the university buildings:
-    //
-    int buildingCount = ReadUniversityBuildings(xmldoc, Nodes, Buildings);
+        if (applyOsmChange(changeFilename, *data, changeStats)){
+            outputChangeStats(changeFilename, changeStats, loadMs);
+        }
+    }
 
     //
     // Stats
     //
-    assert(nodeCount == (int)Nodes.size());
-    assert(footwayCount == (int)Footways.size());
-    assert(buildingCount == (int)Buildings.size());
-
     cout << endl;
-    cout << "# of nodes: " << Nodes.size() << endl;
-    cout << "# of footways: " << Footways.size() << endl;
-    cout << "# of buildings: " << Buildings.size() << endl;
+    cout << "# of nodes: " << data->Nodes.size() << endl;
+    cout << "# of footways: " << data->Footways.size() << endl;
+    outputWayClasses(*data);
+    cout << "# of buildings: " << data->Buildings.size() << endl;
+
+    cout << "# of vertices: " << data->G.NumVertices() << endl;
+    cout << "# of edges: " << data->G.NumEdges() << endl;
 
-    // loops through Nodes and adds each node to G as a vertex
-    for (auto& pair : Nodes){
-        G.addVertex(pair.first);
+    if (model != DistanceModel::SphericalCosines){
+        cout << "Distance model: " << distanceModelName(data->Model) << endl;
     }
 
-    // loops through Footways, taking each footway and adding each pair of nodes as an edge to G
-    for (FootwayInfo& footway : Footways){
+    if (precompute){
+        data->Trees.build(*data, numThreads);
+        cout << "# of precomputed trees: " << data->Trees.numTrees()
+             << " (" << data->Trees.bytes() << " bytes)" << endl;
+    }
+    cout << endl;
 
-        int nodeCount = footway.Nodes.size();
+    //
+    // Memory held by each structure, and the resident set through the load
+    //
+    // the XML document is already freed here, and shows under the load phases
+    long servingKiB = residentKiB();
 
-        for (int i = 0; i < nodeCount - 1; i++){
+    if (printMemory){
+        printFootprints(cout, mapFootprints(*data));
+        cout << endl;
+        loadPhases.print(cout);
+        cout << "  resident before serving: " << servingKiB << " KiB" << endl;
+        cout << endl;
+    }
 
-            long long node1 = footway.Nodes.at(i), node2 = footway.Nodes.at(i + 1);
-            double dist = distBetween2Points(Nodes[node1].Lat, Nodes[node1].Lon, Nodes[node2].Lat, Nodes[node2].Lon);
+    // the server always keeps latency histograms, for its STATS replies
+    unique_ptr<QueryTracer> tracer;
+    if (printLatencyAtEnd || traceFilename != "" || socketPath != ""){
+        tracer = make_unique<QueryTracer>(traceFilename != "");
+    }
 
-            if (!G.addEdge(node1, node2, dist)){
-                cout << "Unable to add path from " << node1 << " to " << node2 << "(" << dist << ")\n";
-            }
+    // Execute Application
+    if (batchFilename != ""){
+        batchApplication(data, batchFilename, numThreads, cacheEntries, tracer.get());
+    }
+    else if (socketPath != ""){
+        MapSource source;
+        source.filename = filename;
+        source.model = model;
+        source.ways = ways;
+        source.maxRelError = maxDistanceError;
+        source.changeFilenames = changeFilenames;
+        source.precompute = precompute;
+        source.numThreads = numThreads;
+        source.watchInterval = chrono::milliseconds(static_cast<long long>(watchSeconds * 1000));
+
+        runServer(std::move(data), source, socketPath, numThreads, cacheEntries, tracer.get());
+    }
+    else{
+        application(*data, tracer.get(), alternatives);
+    }
 
-            if (!G.addEdge(node2, node1, dist)){
-                cout << "Unable to add path from " << node2 << " to " << node1 << "(" << dist << ")\n";
-            }
+    //
+    // Query latency, when traced
+    //
+    if (tracer && printLatencyAtEnd){
+        tracer->printLatency(cout);
+        cout << endl;
+    }
 
-        }
+    if (tracer && traceFilename != ""){
+        ofstream traceFile(traceFilename);
+        tracer->writeTraceJson(traceFile);
+        traceFile << endl;
+    }
+
+    if (printMemory){
+        cout << "Resident after serving: " << residentKiB() << " KiB (" << servingKiB << " KiB before)" << endl;
+        cout << endl;
     }
 
+    //
+    // Instrumentation, when built in
+    //
+    StatsSnapshot stats = statsSnapshot();
 
-    cout << "# of vertices: " << G.NumVertices() << endl;
-    cout << "# of edges: " << G.NumEdges() << endl;
-    cout << endl;
+    if (printStatsAtEnd){
+        printStats(cout, stats);
+        cout << endl;
+    }
 
-    // Execute Application
-    application(Nodes, Footways, Buildings, G);
+    if (statsFilename != ""){
+        ofstream statsFile(statsFilename);
+        writeStatsJson(statsFile, stats);
+        statsFile << endl;
+    }
 
     //
     // done:
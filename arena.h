@@ -0,0 +1,136 @@
+// arena.h
+//
+// Allocation policies for fixed-size nodes, such as the edges of graph<>. A
+// policy hands out default-constructed objects of one type T and provides
+//
+//    T* allocate()             a new object
+//    void deallocate(T*)       gives one object back
+//    void release()            destroys every object still allocated
+//    FreesIndividually         true if objects must be deallocated one by one
+//                              before release(), false if release() covers them
+//
+// HeapAllocator is plain new and delete. ArenaAllocator carves objects out of a
+// few large blocks, so allocation is a pointer bump and release() is one free
+// per block.
+
+#pragma once
+
+#include <vector>
+#include <new>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+using namespace std;
+
+template<typename T>
+class HeapAllocator {
+    public:
+
+        static constexpr bool FreesIndividually = true;
+
+        T* allocate() { return new T(); }
+        void deallocate(T* p) { delete p; }
+        void release() {}
+
+        size_t bytes() const { return 0; } // not tracked
+};
+
+template<typename T, size_t FirstBlock = 64, size_t MaxBlock = 16384>
+class ArenaAllocator {
+    private:
+
+        struct Block{
+            T* items;
+            size_t capacity;
+        };
+
+        vector<Block> blocks;
+        size_t used = 0; // objects handed out from the last block
+
+        static T* _NewBlock(size_t capacity) {
+            return static_cast<T*>(::operator new(capacity * sizeof(T), align_val_t(alignof(T))));
+        }
+
+        static void _DeleteBlock(T* items) {
+            ::operator delete(items, align_val_t(alignof(T)));
+        }
+
+    public:
+
+        static constexpr bool FreesIndividually = false;
+
+        ArenaAllocator() {}
+        ArenaAllocator(const ArenaAllocator&) = delete;
+        ArenaAllocator& operator=(const ArenaAllocator&) = delete;
+
+        // moving hands over the blocks, and every object in them
+        ArenaAllocator(ArenaAllocator&& other) noexcept
+            : blocks(std::move(other.blocks)), used(other.used) {
+            other.blocks.clear();
+            other.used = 0;
+        }
+
+        ArenaAllocator& operator=(ArenaAllocator&& other) noexcept {
+            if (this != &other){
+                release();
+                blocks = std::move(other.blocks);
+                used = other.used;
+                other.blocks.clear();
+                other.used = 0;
+            }
+            return *this;
+        }
+
+        ~ArenaAllocator() { release(); }
+
+        //
+        // allocate
+        //
+        // Returns a new object from the current block, starting a new block,
+        // twice the size of the last one up to MaxBlock objects, when it is full.
+        //
+        T* allocate() {
+            if (blocks.empty() || used == blocks.back().capacity){
+                size_t capacity = blocks.empty() ? FirstBlock : min(MaxBlock, blocks.back().capacity * 2);
+                blocks.push_back(Block{_NewBlock(capacity), capacity});
+                used = 0;
+            }
+
+            return new (blocks.back().items + used++) T();
+        }
+
+        // objects are only reclaimed by release()
+        void deallocate(T*) {}
+
+        //
+        // release
+        //
+        // Destroys every object and frees the blocks.
+        //
+        void release() {
+            for (size_t b = 0; b < blocks.size(); b++){
+                if constexpr (!is_trivially_destructible_v<T>){
+                    size_t count = (b + 1 == blocks.size()) ? used : blocks[b].capacity;
+                    for (size_t i = 0; i < count; i++){
+                        blocks[b].items[i].~T();
+                    }
+                }
+
+                _DeleteBlock(blocks[b].items);
+            }
+
+            blocks.clear();
+            used = 0;
+        }
+
+        // bytes held by the blocks
+        size_t bytes() const {
+            size_t total = 0;
+            for (const Block& block : blocks){
+                total += block.capacity * sizeof(T);
+            }
+            return total;
+        }
+};
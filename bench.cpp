@@ -0,0 +1,606 @@
+// bench.cpp
+//
+// Benchmarks. Each section times one part of the program on generated data and
+// prints a small report; run all of them with `make bench`, or pass section names
+// to bench.exe to pick.
+//
+//    distance   the distance models of distmodel.h against distBetween2Points(),
+//               with the error of each at campus, city and region scale
+//    names      building lookups by abbreviation and partial name, scanning the
+//               building table against the BuildingIndex, and its fuzzy lookups
+//               and completions
+//    map        every phase of loading a real map file (parsing, reading nodes,
+//               footways and buildings, building the graph) and of a meeting
+//               query (findDestinationBuilding, findNearestNodes, dijkstra), with
+//               median and p99 timings and memory use
+//
+// Options: --map FILE picks the map for the map section (uic.osm by default),
+// --runs N and --queries N how often each load phase and query stage is timed,
+// and --json FILE writes the map section's results as JSON, so runs can be
+// compared across commits.
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <fstream>
+#include <algorithm>
+#include <set>
+
+#include "dist.h"
+#include "distmodel.h"
+#include "buildingindex.h"
+#include "mapdata.h"
+#include "query.h"
+#include "footprint.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+// keeps results alive so the compiler cannot drop the timed work
+static volatile double benchSink;
+
+// command line options
+static string mapFile = "uic.osm";
+static string jsonFile;
+static int benchRuns = 7;
+static int benchQueries = 200;
+
+/*function times fn, which performs `calls` operations, and returns nanoseconds per call
+the best of 5 runs is kept, to filter out noise*/
+static double nsPerCall(const function<double()>& fn, size_t calls){
+
+    double best = INFINITY;
+
+    for (int run = 0; run < 5; run++){
+        auto start = Clock::now();
+        benchSink = fn();
+        double ns = chrono::duration<double, nano>(Clock::now() - start).count();
+
+        best = min(best, ns / calls);
+    }
+
+    return best;
+}
+
+//
+// ErrorStats
+//
+// Largest and mean absolute error in feet, and largest relative error.
+//
+struct ErrorStats
+{
+  double maxFeet = 0;
+  double sumFeet = 0;
+  double maxRel = 0;
+  size_t count = 0;
+
+  void add(double value, double reference){
+    double err = fabs(value - reference);
+    maxFeet = max(maxFeet, err * 5280);
+    sumFeet += err * 5280;
+    if (reference > 0) maxRel = max(maxRel, err / reference);
+    count++;
+  }
+};
+
+/*function computes a reference distance in long double precision with the haversine
+formula, using the same constants as dist.cpp so only the formula's rounding is measured*/
+static double referenceDistance(double lat1, double lon1, double lat2, double lon2){
+
+    const long double Radians = 3.14159265L / 180.0L;
+    long double dLat = (lat2 - lat1) * Radians, dLon = (lon2 - lon1) * Radians;
+    long double a = sinl(dLat / 2) * sinl(dLat / 2)
+                  + cosl(lat1 * Radians) * cosl(lat2 * Radians) * sinl(dLon / 2) * sinl(dLon / 2);
+
+    return static_cast<double>(2 * 3963.1L * asinl(sqrtl(a)));
+}
+
+/*function benchmarks the distance models on random pairs of points within a square of
+the given size around Chicago, and reports speed and error against both the current
+formula and a long double reference*/
+static void benchDistanceScale(const string& label, double extentDegrees){
+
+    const size_t N = 200000;
+    mt19937_64 rng(251);
+    uniform_real_distribution<double> latDist(41.87 - extentDegrees / 2, 41.87 + extentDegrees / 2);
+    uniform_real_distribution<double> lonDist(-87.65 - extentDegrees / 2, -87.65 + extentDegrees / 2);
+
+    vector<double> lat1(N), lon1(N), lat2(N), lon2(N);
+    for (size_t i = 0; i < N; i++){
+        lat1[i] = latDist(rng); lon1[i] = lonDist(rng);
+        // half the pairs are short hops, the usual footway edge
+        if (i % 2){
+            lat2[i] = lat1[i] + (latDist(rng) - 41.87) * 1e-3;
+            lon2[i] = lon1[i] + (lonDist(rng) + 87.65) * 1e-3;
+        }
+        else{
+            lat2[i] = latDist(rng); lon2[i] = lonDist(rng);
+        }
+    }
+
+    vector<double> current(N), reference(N);
+    for (size_t i = 0; i < N; i++){
+        current[i] = distBetween2Points(lat1[i], lon1[i], lat2[i], lon2[i]);
+        reference[i] = referenceDistance(lat1[i], lon1[i], lat2[i], lon2[i]);
+    }
+
+    // prepared points, as the graph builder keeps them
+    SphericalCosines cosines;
+    Haversine haversine;
+    Equirectangular planar(41.87);
+
+    vector<UnitVector> u1(N), u2(N);
+    vector<Equirectangular::Point> p1(N), p2(N);
+    PointArrays a1, a2;
+    for (size_t i = 0; i < N; i++){
+        u1[i] = cosines.prepare(lat1[i], lon1[i]);
+        u2[i] = cosines.prepare(lat2[i], lon2[i]);
+        p1[i] = planar.prepare(lat1[i], lon1[i]);
+        p2[i] = planar.prepare(lat2[i], lon2[i]);
+        a1.push_back(lat1[i], lon1[i]);
+        a2.push_back(lat2[i], lon2[i]);
+    }
+
+    vector<double> out(N);
+
+    struct Row { string name; double ns; ErrorStats vsCurrent, vsReference; };
+    vector<Row> rows;
+
+    auto addRow = [&](const string& name, const function<double()>& run){
+        Row row{name, nsPerCall(run, N), {}, {}};
+        for (size_t i = 0; i < N; i++){
+            row.vsCurrent.add(out[i], current[i]);
+            row.vsReference.add(out[i], reference[i]);
+        }
+        rows.push_back(row);
+    };
+
+    addRow("distBetween2Points", [&]{
+        for (size_t i = 0; i < N; i++) out[i] = distBetween2Points(lat1[i], lon1[i], lat2[i], lon2[i]);
+        return out[N / 2];
+    });
+    addRow("batch (SIMD) cosines", [&]{
+        distBetweenPairs(a1, 0, a2, 0, N, out.data());
+        return out[N / 2];
+    });
+    addRow("cosines, prepared", [&]{
+        for (size_t i = 0; i < N; i++) out[i] = cosines.distance(u1[i], u2[i]);
+        return out[N / 2];
+    });
+    addRow("haversine, prepared", [&]{
+        for (size_t i = 0; i < N; i++) out[i] = haversine.distance(u1[i], u2[i]);
+        return out[N / 2];
+    });
+    addRow("planar, prepared", [&]{
+        for (size_t i = 0; i < N; i++) out[i] = planar.distance(p1[i], p2[i]);
+        return out[N / 2];
+    });
+
+    cout << label << " (" << extentDegrees << " degrees across, " << N << " pairs)" << endl;
+    cout << left << setw(24) << "  model" << right << setw(10) << "ns/call"
+         << setw(16) << "max ft vs cur" << setw(14) << "max rel cur"
+         << setw(16) << "max ft vs ref" << setw(14) << "max rel ref" << endl;
+
+    for (const Row& row : rows){
+        cout << left << setw(24) << ("  " + row.name) << right << fixed << setprecision(2) << setw(10) << row.ns
+             << scientific << setprecision(2)
+             << setw(16) << row.vsCurrent.maxFeet << setw(14) << row.vsCurrent.maxRel
+             << setw(16) << row.vsReference.maxFeet << setw(14) << row.vsReference.maxRel << endl;
+    }
+    cout << defaultfloat << endl;
+}
+
+static void benchDistance(){
+
+    cout << "== distance ==" << endl;
+    benchDistanceScale("campus", 0.02);
+    benchDistanceScale("city", 0.5);
+    benchDistanceScale("region", 5.0);
+}
+
+/*function finds a building the way findBuildings() did before the name index: by
+abbreviation, then by partial name, scanning the whole table each time*/
+static int scanBuildings(const vector<BuildingInfo>& Buildings, const string& query){
+
+    for (size_t b = 0; b < Buildings.size(); b++){
+        if (Buildings[b].Abbrev == query) return static_cast<int>(b);
+    }
+
+    for (size_t b = 0; b < Buildings.size(); b++){
+        if (Buildings[b].Fullname.find(query) != string::npos) return static_cast<int>(b);
+    }
+
+    return -1;
+}
+
+/*function benchmarks building lookups on a generated campus of the given size, with
+queries that hit an abbreviation, hit part of a name, or miss*/
+static void benchNamesSize(size_t buildingCount){
+
+    const vector<string> words = {
+        "Science", "Engineering", "Hall", "Library", "Center", "Student", "Union", "Research",
+        "Medical", "Arts", "Business", "Administration", "Laboratory", "Physics", "Chemistry",
+        "Recreation", "Residence", "Theatre", "Music", "Behavioral", "Sciences", "Education",
+        "Pavilion", "Annex", "North", "South", "East", "West", "Memorial", "Institute"
+    };
+
+    mt19937_64 rng(251);
+    uniform_int_distribution<size_t> wordDist(0, words.size() - 1);
+    uniform_int_distribution<int> lengthDist(2, 5);
+
+    vector<BuildingInfo> Buildings(buildingCount);
+    for (size_t b = 0; b < buildingCount; b++){
+        int length = lengthDist(rng);
+        for (int w = 0; w < length; w++){
+            const string& word = words[wordDist(rng)];
+            Buildings[b].Fullname += (w ? " " : "") + word;
+            Buildings[b].Abbrev += word[0];
+        }
+        // numbered, as large campuses are, so most names and abbreviations are unique
+        Buildings[b].Fullname += " " + to_string(b);
+        Buildings[b].Abbrev += to_string(b);
+        Buildings[b].Coords = Coordinates(b + 1, 41.87, -87.65);
+    }
+
+    vector<float> popularity(buildingCount);
+    uniform_real_distribution<float> popularityDist(0, 1);
+    for (float& p : popularity) p = popularityDist(rng);
+
+    auto start = Clock::now();
+    BuildingIndex index;
+    index.build(Buildings, popularity);
+    double buildMs = chrono::duration<double, milli>(Clock::now() - start).count();
+
+    const size_t Q = 200;
+    uniform_int_distribution<size_t> buildingDist(0, buildingCount - 1);
+    vector<string> abbrevs, partials, misses;
+
+    for (size_t q = 0; q < Q; q++){
+        abbrevs.push_back(Buildings[buildingDist(rng)].Abbrev);
+
+        const string& name = Buildings[buildingDist(rng)].Fullname;
+        size_t length = min<size_t>(name.size(), 12);
+        size_t first = uniform_int_distribution<size_t>(0, name.size() - length)(rng);
+        partials.push_back(name.substr(first, length));
+
+        misses.push_back("Aquarium " + to_string(q));
+    }
+
+    cout << buildingCount << " buildings (index built in " << fixed << setprecision(2) << buildMs << " ms, "
+         << defaultfloat << index.bytes() / 1024 << " KiB)" << endl;
+    cout << left << setw(24) << "  queries" << right << setw(14) << "scan us/query"
+         << setw(15) << "index us/query" << setw(10) << "speedup" << endl;
+
+    for (const auto& [label, queries] : vector<pair<string, const vector<string>*>>{
+             {"abbreviation", &abbrevs}, {"partial name", &partials}, {"no match", &misses}}){
+
+        for (const string& query : *queries){
+            if (scanBuildings(Buildings, query) != index.find(query)){
+                cout << "  **mismatch for '" << query << "'" << endl;
+            }
+        }
+
+        double scanNs = nsPerCall([&]{
+            double found = 0;
+            for (const string& query : *queries) found += scanBuildings(Buildings, query);
+            return found;
+        }, queries->size());
+        double indexNs = nsPerCall([&]{
+            double found = 0;
+            for (const string& query : *queries) found += index.find(query);
+            return found;
+        }, queries->size());
+
+        cout << left << setw(24) << ("  " + label) << right << fixed << setprecision(3)
+             << setw(14) << scanNs / 1000 << setw(15) << indexNs / 1000
+             << setprecision(1) << setw(9) << scanNs / indexNs << "x" << defaultfloat << endl;
+    }
+
+    // misspelled queries: words shortened or given one typo, numbers kept
+    vector<string> typos;
+    vector<int> targets;
+    uniform_int_distribution<int> editDist(0, 3);
+
+    for (size_t q = 0; q < Q; q++){
+        int b = static_cast<int>(buildingDist(rng));
+        string query, word;
+
+        for (char c : Buildings[b].Fullname + " "){
+            if (c != ' '){
+                word += c;
+                continue;
+            }
+
+            if (!isdigit((unsigned char)word[0]) && word.size() > 4){
+                size_t at = uniform_int_distribution<size_t>(1, word.size() - 2)(rng);
+                switch (editDist(rng)){
+                    case 0: word.erase(at, 1); break;                 // dropped letter
+                    case 1: swap(word[at], word[at + 1]); break;      // swapped letters
+                    case 2: word = word.substr(0, 4); break;          // shortened
+                    default: break;
+                }
+            }
+
+            query += (query.empty() ? "" : " ") + word;
+            word.clear();
+        }
+
+        typos.push_back(query);
+        targets.push_back(b);
+    }
+
+    vector<BuildingMatch> matches;
+    size_t top1 = 0, top5 = 0;
+
+    for (size_t q = 0; q < Q; q++){
+        index.fuzzyFind(typos[q], 5, matches);
+        for (size_t i = 0; i < matches.size(); i++){
+            if (matches[i].building == targets[q]){
+                top1 += (i == 0);
+                top5++;
+            }
+        }
+    }
+
+    double fuzzyNs = nsPerCall([&]{
+        double found = 0;
+        for (const string& query : typos){
+            index.fuzzyFind(query, 5, matches);
+            found += matches.size();
+        }
+        return found;
+    }, typos.size());
+
+    cout << left << setw(24) << "  misspelled (top 5)" << right << setw(14) << "-" << fixed << setprecision(3)
+         << setw(15) << fuzzyNs / 1000 << defaultfloat << "   found first " << 100.0 * top1 / Q
+         << "%, in top 5 " << 100.0 * top5 / Q << "%" << endl;
+
+    // type-ahead: every prefix of the first two words of a name, as it is typed
+    vector<string> keystrokes;
+    for (size_t q = 0; q < Q; q++){
+        const string& name = Buildings[buildingDist(rng)].Fullname;
+        size_t end = name.find(' ', name.find(' ') + 1);
+        for (size_t length = 1; length <= min(end, name.size()); length++){
+            keystrokes.push_back(name.substr(0, length));
+        }
+    }
+
+    vector<int> suggestions;
+    double completeNs = nsPerCall([&]{
+        double found = 0;
+        for (const string& prefix : keystrokes){
+            index.complete(prefix, 8, suggestions);
+            found += suggestions.size();
+        }
+        return found;
+    }, keystrokes.size());
+
+    cout << left << setw(24) << "  completion (top 8)" << right << setw(14) << "-" << fixed << setprecision(3)
+         << setw(15) << completeNs / 1000 << defaultfloat << "   per keystroke" << endl;
+    cout << endl;
+}
+
+static void benchNames(){
+
+    cout << "== names ==" << endl;
+    benchNamesSize(500);
+    benchNamesSize(50000);
+}
+
+//
+// Timing
+//
+// Summary of repeated measurements of one phase, in microseconds.
+//
+struct Timing
+{
+  string name;
+  size_t samples = 0;
+  double median = 0, p99 = 0, mean = 0, fastest = 0, slowest = 0;
+
+  Timing(const string& name, vector<double> us) : name(name), samples(us.size()) {
+    if (us.empty()) return;
+
+    sort(us.begin(), us.end());
+    // nearest rank, so with few samples p99 is the slowest
+    auto rank = [&us](double p){ return us[min(us.size() - 1, (size_t)ceil(p * us.size()) - 1)]; };
+
+    median = rank(0.5);
+    p99 = rank(0.99);
+    fastest = us.front();
+    slowest = us.back();
+    for (double t : us) mean += t / us.size();
+  }
+};
+
+/*function times fn once, in microseconds*/
+static double timeUs(const function<void()>& fn){
+
+    auto start = Clock::now();
+    fn();
+    return chrono::duration<double, micro>(Clock::now() - start).count();
+}
+
+/*function benchmarks loading the map file given with --map and answering meeting
+queries on it, prints the timings, and writes them as JSON if --json was given*/
+static void benchMap(){
+
+    cout << "== map ==" << endl;
+
+    vector<Timing> timings;
+    long baseKiB = residentKiB();
+
+    // each load phase is timed on the output of the ones before it, in the order
+    // loadMapData() runs them, so the phases add up to about a whole load
+    vector<double> parse, nodes, footways, buildings, indexes, graphs, total;
+
+    for (int run = 0; run < benchRuns; run++){
+
+        XMLDocument xmldoc;
+        MapData data;
+        bool loaded = true;
+
+        parse.push_back(timeUs([&]{ loaded = LoadOpenStreetMap(mapFile, xmldoc); }));
+        if (!loaded){
+            cout << "could not load '" << mapFile << "'; pick a map with --map FILE" << endl << endl;
+            return;
+        }
+
+        nodes.push_back(timeUs([&]{ ReadMapNodes(xmldoc, data.Nodes); }));
+        footways.push_back(timeUs([&]{ ReadFootways(xmldoc, data.Footways, data.Ways); }));
+        buildings.push_back(timeUs([&]{
+            ReadUniversityBuildings(xmldoc, data.Nodes, data.Buildings, &data.BuildingOutlines);
+        }));
+        indexes.push_back(timeUs([&]{ buildIndexes(data); }));
+        graphs.push_back(timeUs([&]{ buildGraph(data); }));
+
+        MapData whole;
+        total.push_back(timeUs([&]{ loadMapData(mapFile, whole); }));
+    }
+
+    timings.emplace_back("LoadOpenStreetMap", parse);
+    timings.emplace_back("ReadMapNodes", nodes);
+    timings.emplace_back("ReadFootways", footways);
+    timings.emplace_back("ReadUniversityBuildings", buildings);
+    timings.emplace_back("buildIndexes", indexes);
+    timings.emplace_back("buildGraph", graphs);
+    timings.emplace_back("loadMapData", total);
+
+    // the map the queries run on stays loaded, for the memory figures
+    MapData data;
+    MemoryPhases loadPhases;
+    loadMapData(mapFile, data, DistanceModel::SphericalCosines, 1e-3, &loadPhases);
+    long loadedKiB = residentKiB();
+
+    vector<double> destination, nearest, search, timeSearch, accessibleSearch;
+    SearchWorkspace ws;
+    mt19937_64 rng(251);
+
+    if (data.Buildings.size() >= 2){
+
+        uniform_int_distribution<size_t> buildingDist(0, data.Buildings.size() - 1);
+
+        for (int q = 0; q < benchQueries; q++){
+
+            const BuildingInfo& building1 = data.Buildings[buildingDist(rng)];
+            const BuildingInfo& building2 = data.Buildings[buildingDist(rng)];
+            set<string> usedBuildings;
+            BuildingInfo center;
+            vector<long long> closestNodes;
+
+            destination.push_back(timeUs([&]{
+                center = findDestinationBuilding(data.Buildings, data.BuildingPoints, building1, building2, usedBuildings);
+            }));
+            nearest.push_back(timeUs([&]{ findNearestNodes(data, building1, building2, center, closestNodes); }));
+
+            int start = data.Search.indexOf(closestNodes.at(0));
+            search.push_back(timeUs([&]{ dijkstra(start, data.Search, ws); }));
+            timeSearch.push_back(timeUs([&]{ dijkstraBy<WalkingTimeCost>(start, data.Search, ws); }));
+            accessibleSearch.push_back(timeUs([&]{ dijkstraBy<AccessibleCost>(start, data.Search, ws); }));
+        }
+    }
+
+    timings.emplace_back("findDestinationBuilding", destination);
+    timings.emplace_back("findNearestNodes", nearest);
+    timings.emplace_back("dijkstra", search);
+    timings.emplace_back("dijkstra (time)", timeSearch);
+    timings.emplace_back("dijkstra (accessible)", accessibleSearch);
+
+    cout << mapFile << ": " << data.Nodes.size() << " nodes, " << data.Footways.size() << " footways, "
+         << data.Buildings.size() << " buildings, " << data.Search.numVertices() << " vertices, "
+         << data.Search.numEdges() << " edges" << endl;
+    cout << left << setw(26) << "  phase" << right << setw(9) << "samples" << setw(14) << "median us"
+         << setw(14) << "p99 us" << setw(14) << "mean us" << endl;
+
+    for (const Timing& timing : timings){
+        cout << left << setw(26) << ("  " + timing.name) << right << setw(9) << timing.samples << fixed << setprecision(2)
+             << setw(14) << timing.median << setw(14) << timing.p99 << setw(14) << timing.mean << defaultfloat << endl;
+    }
+
+    // the structures' own sizes, and what the process holds
+    vector<Footprint> footprints = mapFootprints(data);
+
+    auto totalOf = [&footprints](const string& name){
+        for (const Footprint& f : footprints) if (f.name == name) return (long long)f.total();
+        return 0LL;
+    };
+
+    vector<pair<string, long long>> memory = {
+        {"nodeStoreBytes", totalOf("Nodes")},
+        {"graphEdgeBytes", totalOf("graph edges")},
+        {"searchGraphBytes", totalOf("Search")},
+        {"buildingIndexBytes", totalOf("BuildingNames")},
+        {"rssAfterLoadKiB", loadedKiB},
+        {"rssGrowthKiB", loadedKiB - baseKiB},
+        {"peakRssKiB", peakResidentKiB()},
+    };
+
+    cout << "  memory:";
+    for (const auto& [name, value] : memory){
+        cout << " " << name << "=" << value;
+    }
+    cout << endl;
+    printFootprints(cout, footprints);
+    loadPhases.print(cout);
+    cout << endl;
+
+    if (jsonFile.empty()) return;
+
+    ofstream json(jsonFile);
+    json << setprecision(6);
+    json << "{\"map\":\"" << mapFile << "\",\"nodes\":" << data.Nodes.size() << ",\"footways\":" << data.Footways.size()
+         << ",\"buildings\":" << data.Buildings.size() << ",\"edges\":" << data.Search.numEdges() << ",\"timings\":{";
+
+    for (size_t i = 0; i < timings.size(); i++){
+        const Timing& t = timings[i];
+        json << (i ? "," : "") << "\"" << t.name << "\":{\"unit\":\"us\",\"samples\":" << t.samples
+             << ",\"median\":" << t.median << ",\"p99\":" << t.p99 << ",\"mean\":" << t.mean
+             << ",\"min\":" << t.fastest << ",\"max\":" << t.slowest << "}";
+    }
+
+    json << "},\"memory\":{";
+    for (size_t i = 0; i < memory.size(); i++){
+        json << (i ? "," : "") << "\"" << memory[i].first << "\":" << memory[i].second;
+    }
+    json << "},\"structures\":";
+    writeFootprintsJson(json, footprints);
+    json << ",\"loadPhases\":";
+    loadPhases.writeJson(json);
+    json << "}" << endl;
+
+    cout << "wrote " << jsonFile << endl << endl;
+}
+
+int main(int argc, char* argv[]) {
+
+    vector<pair<string, function<void()>>> sections = {
+        {"distance", benchDistance},
+        {"names", benchNames},
+        {"map", benchMap},
+    };
+
+    vector<string> selected;
+
+    for (int i = 1; i < argc; i++){
+        string arg = argv[i];
+
+        if (arg == "--map" && i + 1 < argc) mapFile = argv[++i];
+        else if (arg == "--json" && i + 1 < argc) jsonFile = argv[++i];
+        else if (arg == "--runs" && i + 1 < argc) benchRuns = max(1, atoi(argv[++i]));
+        else if (arg == "--queries" && i + 1 < argc) benchQueries = max(1, atoi(argv[++i]));
+        else selected.push_back(arg);
+    }
+
+    for (const auto& section : sections){
+        if (selected.empty() || find(selected.begin(), selected.end(), section.first) != selected.end()){
+            section.second();
+        }
+    }
+
+    return 0;
+}
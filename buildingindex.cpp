@@ -0,0 +1,586 @@
+// buildingindex.cpp
+//
+// Builds and searches the building name index.
+
+#include <algorithm>
+#include <cstring>
+#include <climits>
+#include <queue>
+
+#include "buildingindex.h"
+
+using namespace std;
+
+/*function lowercases ASCII letters only, so positions in the lowercased name match
+positions in the original
+Takes 1 parameter:
+    c: a character
+Returns the lowercased character*/
+static char lowerAscii(char c){
+
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+/*function splits a lowercased name into words: runs of letters and digits, where
+bytes of multi-byte UTF-8 characters count as letters
+Takes 2 parameters:
+    1. name: the name
+    2. words: filled with views into name
+No returns*/
+static void splitWords(string_view name, vector<string_view>& words){
+
+    words.clear();
+    size_t start = 0;
+
+    for (size_t i = 0; i <= name.size(); i++){
+        unsigned char c = (i < name.size()) ? name[i] : ' ';
+        bool wordChar = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80;
+
+        if (!wordChar){
+            if (i > start) words.push_back(name.substr(start, i - start));
+            start = i + 1;
+        }
+    }
+}
+
+/*function appends the trigrams of a word, padded with a space on each side so the
+first and last letters, and words of one letter, have trigrams of their own
+Takes 2 parameters:
+    1. word: a lowercased word
+    2. grams: the trigrams, each packed into the low 24 bits
+No returns*/
+static void addTrigrams(string_view word, vector<uint32_t>& grams){
+
+    string padded = " " + string(word) + " ";
+
+    for (size_t i = 0; i + 3 <= padded.size(); i++){
+        grams.push_back((uint32_t)(unsigned char)padded[i] << 16
+                      | (uint32_t)(unsigned char)padded[i + 1] << 8
+                      | (uint32_t)(unsigned char)padded[i + 2]);
+    }
+}
+
+/*function finds the edits allowed between a query word and a name word: none for
+the shortest words, where any edit changes the word entirely, up to 3 for long ones
+Takes 1 parameter:
+    length: the query word's length
+Returns the largest number of edits*/
+static int editBound(size_t length){
+
+    if (length <= 2) return 0;
+    if (length <= 5) return 1;
+    if (length <= 9) return 2;
+    return 3;
+}
+
+/*function computes the edit distance between word and the closest prefix of
+nameWord (insertions, deletions, substitutions and swaps of adjacent letters),
+giving up past bound
+Takes 3 parameters:
+    1. word: the query word
+    2. nameWord: a word of a building's name
+    3. bound: the largest distance of interest
+Returns the distance, or bound + 1 if it is larger than bound*/
+static int prefixEditDistance(string_view word, string_view nameWord, int bound){
+
+    const size_t MaxLength = 64;
+    size_t n = min(word.size(), MaxLength);
+
+    // column[i] = edits between word[0, i) and the prefix of nameWord read so far;
+    // previous holds the column before, for swaps
+    int previous[MaxLength + 1], column[MaxLength + 1], next[MaxLength + 1];
+    for (size_t i = 0; i <= n; i++) column[i] = static_cast<int>(i);
+
+    int best = column[n];
+    int previousMin = INT_MAX / 2;
+
+    for (size_t j = 0; j < nameWord.size() && best > 0; j++){
+
+        next[0] = static_cast<int>(j + 1);
+        int columnMin = next[0];
+
+        for (size_t i = 1; i <= n; i++){
+            next[i] = min({column[i] + 1, next[i - 1] + 1, column[i - 1] + (word[i - 1] != nameWord[j])});
+
+            if (i > 1 && j > 0 && word[i - 1] == nameWord[j - 1] && word[i - 2] == nameWord[j]){
+                next[i] = min(next[i], previous[i - 2] + 1);
+            }
+
+            columnMin = min(columnMin, next[i]);
+        }
+
+        copy(column, column + n + 1, previous);
+        copy(next, next + n + 1, column);
+
+        best = min(best, column[n]);
+
+        // longer prefixes cost at least this column's smallest entry, or one more than
+        // the column before's, through a swap
+        if (min(columnMin, previousMin + 1) > bound) break;
+        previousMin = columnMin;
+    }
+
+    return min(best, bound + 1);
+}
+
+void BuildingIndex::build(const vector<BuildingInfo>& Buildings, const vector<float>& Popularity){
+
+    buildings = &Buildings;
+    popularity = Popularity;
+    popularity.resize(Buildings.size(), 0.0f);
+    byAbbrev.clear();
+    text.clear();
+    nameStart.clear();
+    suffixes.clear();
+    suffixBuilding.clear();
+    gramKeys.clear();
+    gramStart.clear();
+    gramBuildings.clear();
+    completions.clear();
+    completionBuilding.clear();
+    popularTree.clear();
+
+    for (size_t b = 0; b < Buildings.size(); b++){
+
+        // emplace keeps the first building with an abbreviation, as the linear search did
+        byAbbrev.emplace(string_view(Buildings[b].Abbrev), static_cast<int>(b));
+
+        nameStart.push_back(static_cast<int>(text.size()));
+        for (char c : Buildings[b].Fullname){
+            text += lowerAscii(c);
+        }
+        text += '\0';
+    }
+    namesEnd = static_cast<int>(text.size());
+
+    for (size_t b = 0; b < Buildings.size(); b++){
+        int length = static_cast<int>(_NameOf(static_cast<int>(b)).size());
+
+        for (int i = nameStart[b]; i < nameStart[b] + length; i++){
+            suffixes.push_back(i);
+        }
+    }
+
+    // each suffix ends at its name's '\0', so strcmp compares within one name
+    const char* t = text.c_str();
+    sort(suffixes.begin(), suffixes.end(), [t](int a, int b){
+        int order = strcmp(t + a, t + b);
+        return order < 0 || (order == 0 && a < b);
+    });
+
+    suffixBuilding.resize(suffixes.size());
+    for (size_t i = 0; i < suffixes.size(); i++){
+        suffixBuilding[i] = _BuildingAt(suffixes[i]);
+    }
+
+    // (trigram, building) pairs, sorted, become one posting list per trigram
+    vector<uint64_t> postings;
+    vector<string_view> words;
+    vector<uint32_t> grams;
+
+    for (size_t b = 0; b < Buildings.size(); b++){
+        grams.clear();
+        splitWords(_NameOf(static_cast<int>(b)), words);
+        for (string_view word : words){
+            addTrigrams(word, grams);
+        }
+
+        for (uint32_t gram : grams){
+            postings.push_back((uint64_t)gram << 32 | b);
+        }
+    }
+
+    sort(postings.begin(), postings.end());
+    postings.erase(unique(postings.begin(), postings.end()), postings.end());
+
+    for (uint64_t posting : postings){
+        uint32_t gram = static_cast<uint32_t>(posting >> 32);
+
+        if (gramKeys.empty() || gramKeys.back() != gram){
+            gramKeys.push_back(gram);
+            gramStart.push_back(static_cast<int>(gramBuildings.size()));
+        }
+        gramBuildings.push_back(static_cast<int>(posting & 0xffffffffu));
+    }
+    gramStart.push_back(static_cast<int>(gramBuildings.size()));
+
+    // completions: every word of the names, and the abbreviations, which go at the
+    // end of text
+    for (size_t b = 0; b < Buildings.size(); b++){
+        string_view name = _NameOf(static_cast<int>(b));
+        splitWords(name, words);
+
+        for (string_view word : words){
+            completions.push_back(nameStart[b] + static_cast<int>(word.data() - name.data()));
+        }
+    }
+
+    for (size_t b = 0; b < Buildings.size(); b++){
+        if (Buildings[b].Abbrev.empty()) continue;
+
+        completions.push_back(static_cast<int>(text.size()));
+        for (char c : Buildings[b].Abbrev){
+            text += lowerAscii(c);
+        }
+        text += '\0';
+    }
+
+    // text may have moved while growing
+    t = text.c_str();
+    sort(completions.begin(), completions.end(), [t](int a, int b){
+        int order = strcmp(t + a, t + b);
+        return order < 0 || (order == 0 && a < b);
+    });
+
+    // abbreviations are in building order, so the building of one is found by
+    // counting the non-empty abbreviations before it
+    vector<int> abbrevBuilding;
+    for (size_t b = 0; b < Buildings.size(); b++){
+        if (!Buildings[b].Abbrev.empty()) abbrevBuilding.push_back(static_cast<int>(b));
+    }
+
+    vector<int> abbrevStart;
+    for (int i = namesEnd; i < (int)text.size(); i += static_cast<int>(strlen(t + i)) + 1){
+        abbrevStart.push_back(i);
+    }
+
+    completionBuilding.resize(completions.size());
+    for (size_t i = 0; i < completions.size(); i++){
+        int position = completions[i];
+
+        if (position < namesEnd){
+            completionBuilding[i] = _BuildingAt(position);
+        }
+        else{
+            size_t a = lower_bound(abbrevStart.begin(), abbrevStart.end(), position) - abbrevStart.begin();
+            completionBuilding[i] = abbrevBuilding[a];
+        }
+    }
+
+    // leaves at [m, 2m) hold the completions themselves
+    size_t m = completions.size();
+    popularTree.resize(2 * m);
+    for (size_t i = 0; i < m; i++){
+        popularTree[m + i] = static_cast<int>(i);
+    }
+    for (size_t i = m; i-- > 1; ){
+        int left = popularTree[2 * i], right = popularTree[2 * i + 1];
+        popularTree[i] = _MorePopular(right, left) ? right : left;
+    }
+}
+
+int BuildingIndex::_BuildingAt(int position) const {
+
+    return static_cast<int>(upper_bound(nameStart.begin(), nameStart.end(), position) - nameStart.begin()) - 1;
+}
+
+string_view BuildingIndex::_NameOf(int building) const {
+
+    int end = (building + 1 < (int)nameStart.size()) ? nameStart[building + 1] - 1 : namesEnd - 1;
+    return string_view(text).substr(nameStart[building], end - nameStart[building]);
+}
+
+int BuildingIndex::findAbbrev(const string& abbrev) const {
+
+    auto found = byAbbrev.find(string_view(abbrev));
+    return (found == byAbbrev.end()) ? -1 : found->second;
+}
+
+void BuildingIndex::_MatchRange(const string& name, const int*& first, const int*& last) const {
+
+    string key;
+    for (char c : name){
+        key += lowerAscii(c);
+    }
+
+    // the suffixes starting with key are one contiguous run
+    const char* t = text.c_str();
+    size_t n = key.size();
+
+    first = lower_bound(suffixes.data(), suffixes.data() + suffixes.size(), key, [t, n](int suffix, const string& k){
+        return strncmp(t + suffix, k.c_str(), n) < 0;
+    });
+    last = upper_bound(first, suffixes.data() + suffixes.size(), key, [t, n](const string& k, int suffix){
+        return strncmp(t + suffix, k.c_str(), n) > 0;
+    });
+}
+
+bool BuildingIndex::_MatchesAt(int position, int building, const string& name) const {
+
+    // the lowercased match must also match with the original capitalization
+    return (*buildings)[building].Fullname.compare(position - nameStart[building], name.size(), name) == 0;
+}
+
+void BuildingIndex::matchName(const string& name, vector<int>& matches) const {
+
+    matches.clear();
+
+    if (buildings == nullptr) return;
+
+    // every name contains the empty string
+    if (name.empty()){
+        for (int b = 0; b < (int)buildings->size(); b++){
+            matches.push_back(b);
+        }
+        return;
+    }
+
+    const int *first, *last;
+    _MatchRange(name, first, last);
+
+    for (const int* it = first; it != last; ++it){
+        int b = suffixBuilding[it - suffixes.data()];
+        if (_MatchesAt(*it, b, name)) matches.push_back(b);
+    }
+
+    sort(matches.begin(), matches.end());
+    matches.erase(unique(matches.begin(), matches.end()), matches.end());
+}
+
+int BuildingIndex::findName(const string& name) const {
+
+    if (buildings == nullptr || buildings->empty()) return -1;
+    if (name.empty()) return 0;
+
+    const int *first, *last;
+    _MatchRange(name, first, last);
+
+    // the run is sorted by what follows the match, not by building, so keep the lowest
+    int found = -1;
+    for (const int* it = first; it != last; ++it){
+        int b = suffixBuilding[it - suffixes.data()];
+        if ((found < 0 || b < found) && _MatchesAt(*it, b, name)) found = b;
+    }
+
+    return found;
+}
+
+int BuildingIndex::find(const string& query) const {
+
+    int b = findAbbrev(query);
+    return (b >= 0) ? b : findName(query);
+}
+
+void BuildingIndex::fuzzyFind(const string& query, size_t k, vector<BuildingMatch>& matches) const {
+
+    matches.clear();
+
+    if (buildings == nullptr || k == 0) return;
+
+    string key;
+    for (char c : query){
+        key += lowerAscii(c);
+    }
+
+    vector<string_view> queryWords;
+    splitWords(key, queryWords);
+
+    if (queryWords.empty()) return;
+
+    vector<uint32_t> grams;
+    for (string_view word : queryWords){
+        addTrigrams(word, grams);
+    }
+    sort(grams.begin(), grams.end());
+    grams.erase(unique(grams.begin(), grams.end()), grams.end());
+    if (grams.size() > UINT16_MAX) grams.resize(UINT16_MAX);
+
+    // the posting list of each of the query's trigrams, rarest first
+    vector<pair<int, int>> lists;
+    for (uint32_t gram : grams){
+        auto found = lower_bound(gramKeys.begin(), gramKeys.end(), gram);
+        if (found != gramKeys.end() && *found == gram){
+            size_t g = found - gramKeys.begin();
+            lists.emplace_back(gramStart[g], gramStart[g + 1]);
+        }
+    }
+    sort(lists.begin(), lists.end(), [](const pair<int, int>& a, const pair<int, int>& b){
+        return a.second - a.first < b.second - b.first;
+    });
+
+    // count the trigrams each building shares with the query. Once the rarer half
+    // has been counted and turned up enough candidates, the common trigrams ("hal",
+    // "ing") would touch most of the table for little information, so they are
+    // left out, and treated as shared by every candidate
+    vector<uint16_t> shared(buildings->size(), 0);
+    vector<int> candidates;
+    size_t keep = max<size_t>(8 * k, 64);
+    int uncounted = 0;
+
+    for (size_t l = 0; l < lists.size(); l++){
+
+        if (2 * l >= lists.size() && candidates.size() >= keep){
+            uncounted = static_cast<int>(lists.size() - l);
+            break;
+        }
+
+        for (int i = lists[l].first; i < lists[l].second; i++){
+            if (shared[gramBuildings[i]]++ == 0) candidates.push_back(gramBuildings[i]);
+        }
+    }
+
+    // only the buildings sharing the most trigrams are worth the edit distances
+    auto moreShared = [&shared](int a, int b){
+        return shared[a] > shared[b] || (shared[a] == shared[b] && a < b);
+    };
+
+    if (candidates.size() > keep){
+        nth_element(candidates.begin(), candidates.begin() + keep, candidates.end(), moreShared);
+        candidates.resize(keep);
+    }
+    sort(candidates.begin(), candidates.end(), moreShared);
+
+    // one edit removes at most 4 of the query's trigrams (a swap), and matching a
+    // prefix removes at most the last trigram of each word, so a building sharing
+    // fewer trigrams is at least this many edits away
+    int maxBound = 0;
+    for (string_view word : queryWords){
+        maxBound += editBound(word.size());
+    }
+
+    auto fewestEdits = [&](int b){
+        int missing = static_cast<int>(grams.size()) - uncounted - shared[b] - static_cast<int>(queryWords.size());
+        return max(0, (missing + 3) / 4);
+    };
+
+    vector<string_view> nameWords;
+    vector<int> ranked;
+
+    for (int b : candidates){
+
+        // candidates come with the most shared trigrams first, so once the k-th
+        // best is no further than this one could be, none that follow can beat it
+        int lowest = fewestEdits(b);
+        if (lowest > maxBound) break;
+
+        if (matches.size() >= k){
+            ranked.clear();
+            for (const BuildingMatch& match : matches) ranked.push_back(match.edits);
+            nth_element(ranked.begin(), ranked.begin() + (k - 1), ranked.end());
+            if (lowest >= ranked[k - 1]) break;
+        }
+
+        splitWords(_NameOf(b), nameWords);
+        int edits = 0;
+
+        for (string_view word : queryWords){
+
+            int bound = editBound(word.size());
+            int best = bound + 1;
+
+            for (string_view nameWord : nameWords){
+                // the letters missing from a shorter name word each cost an edit
+                if (word.size() > nameWord.size() + bound) continue;
+                best = min(best, prefixEditDistance(word, nameWord, bound));
+                if (best == 0) break;
+            }
+
+            if (best > bound){
+                edits = -1;
+                break;
+            }
+            edits += best;
+        }
+
+        if (edits >= 0) matches.push_back(BuildingMatch{b, edits});
+    }
+
+    sort(matches.begin(), matches.end(), [&moreShared](const BuildingMatch& a, const BuildingMatch& b){
+        return a.edits < b.edits || (a.edits == b.edits && moreShared(a.building, b.building));
+    });
+
+    if (matches.size() > k) matches.resize(k);
+}
+
+int BuildingIndex::findClosest(const string& query) const {
+
+    vector<BuildingMatch> matches;
+    fuzzyFind(query, 1, matches);
+
+    return matches.empty() ? -1 : matches.front().building;
+}
+
+bool BuildingIndex::_MorePopular(int a, int b) const {
+
+    float pa = popularity[completionBuilding[a]], pb = popularity[completionBuilding[b]];
+    return pa > pb || (pa == pb && completionBuilding[a] < completionBuilding[b]);
+}
+
+int BuildingIndex::_MostPopular(int first, int last) const {
+
+    int best = -1;
+    size_t m = completions.size();
+
+    for (size_t l = first + m, r = last + m; l < r; l /= 2, r /= 2){
+        if (l & 1){
+            int c = popularTree[l++];
+            if (best < 0 || _MorePopular(c, best)) best = c;
+        }
+        if (r & 1){
+            int c = popularTree[--r];
+            if (best < 0 || _MorePopular(c, best)) best = c;
+        }
+    }
+
+    return best;
+}
+
+void BuildingIndex::complete(const string& prefix, size_t k, vector<int>& suggestions) const {
+
+    suggestions.clear();
+
+    if (buildings == nullptr || k == 0 || completions.empty()) return;
+
+    string key;
+    for (char c : prefix){
+        key += lowerAscii(c);
+    }
+
+    const char* t = text.c_str();
+    size_t n = key.size();
+
+    int first = static_cast<int>(lower_bound(completions.begin(), completions.end(), key, [t, n](int completion, const string& k){
+        return strncmp(t + completion, k.c_str(), n) < 0;
+    }) - completions.begin());
+    int last = static_cast<int>(upper_bound(completions.begin() + first, completions.end(), key, [t, n](const string& k, int completion){
+        return strncmp(t + completion, k.c_str(), n) > 0;
+    }) - completions.begin());
+
+    auto suggest = [&](int b){
+        if (std::find(suggestions.begin(), suggestions.end(), b) == suggestions.end()) suggestions.push_back(b);
+    };
+
+    // keys that are exactly the prefix sort first in the run, since '\0' sorts first
+    for (int i = first; i < last && t[completions[i] + n] == '\0' && suggestions.size() < k; i++){
+        if (completions[i] >= namesEnd) suggest(completionBuilding[i]);
+    }
+
+    // then the run's completions, most popular first: each span's best is handed
+    // out, and the two spans either side of it take its place
+    struct Span { int best, first, last; };
+    auto lessPopular = [this](const Span& a, const Span& b){ return _MorePopular(b.best, a.best); };
+    priority_queue<Span, vector<Span>, decltype(lessPopular)> spans(lessPopular);
+
+    if (first < last) spans.push(Span{_MostPopular(first, last), first, last});
+
+    while (!spans.empty() && suggestions.size() < k){
+
+        Span span = spans.top();
+        spans.pop();
+
+        suggest(completionBuilding[span.best]);
+
+        if (span.first < span.best) spans.push(Span{_MostPopular(span.first, span.best), span.first, span.best});
+        if (span.best + 1 < span.last) spans.push(Span{_MostPopular(span.best + 1, span.last), span.best + 1, span.last});
+    }
+}
+
+size_t BuildingIndex::bytes() const {
+
+    return text.capacity() + (nameStart.capacity() + suffixes.capacity() + suffixBuilding.capacity()) * sizeof(int)
+         + gramKeys.capacity() * sizeof(uint32_t) + (gramStart.capacity() + gramBuildings.capacity()) * sizeof(int)
+         + popularity.capacity() * sizeof(float)
+         + (completions.capacity() + completionBuilding.capacity() + popularTree.capacity()) * sizeof(int)
+         + byAbbrev.size() * (sizeof(string_view) + sizeof(int) + 2 * sizeof(void*))
+         + byAbbrev.bucket_count() * sizeof(void*);
+}
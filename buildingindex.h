@@ -0,0 +1,160 @@
+// buildingindex.h
+//
+// Index over the building table for name lookups. Abbreviations are found with
+// a hash map, and partial names with a suffix array over the full names: every
+// building whose name contains the query is found by binary search, instead of
+// by calling Fullname.find() on every building.
+//
+// The suffix array is built over the names lowercased, so one search finds the
+// candidates for any capitalization; candidates are then checked against the
+// original name, which keeps lookups case-sensitive, as findBuildings() has
+// always been. Keys and candidates refer to the BuildingInfo table by position,
+// so no name is copied per lookup; the index must be rebuilt whenever the table
+// changes.
+//
+// Misspelled or shortened names ("sci engr", "Richard J Daly Libary") are found
+// by fuzzy search: an inverted index from each trigram of the names' words to
+// the buildings containing it picks the candidates sharing the most trigrams
+// with the query, and those are ranked by how many edits each query word is
+// from the start of the closest word of their name.
+//
+// Type-ahead completions come from the positions where a name word or an
+// abbreviation starts, sorted like the suffix array, so the keys starting with
+// what has been typed are again one run. A segment tree over the run's
+// popularity hands out its most popular buildings one at a time, so a keystroke
+// costs a binary search plus a few tree walks, whatever the run's length.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "osm.h"
+
+using namespace std;
+
+//
+// BuildingMatch
+//
+// One result of a fuzzy search: the building's position in the table and the
+// number of edits between the query and its name.
+//
+struct BuildingMatch
+{
+  int building;
+  int edits;
+};
+
+class BuildingIndex {
+    private:
+
+        const vector<BuildingInfo>* buildings = nullptr;
+
+        unordered_map<string_view, int> byAbbrev; // views into buildings' Abbrev; first building wins
+        string text;                              // lowercased names, then abbreviations, each followed by '\0'
+        int namesEnd = 0;                         // where the names end and the abbreviations start in text
+        vector<int> nameStart;                    // where each building's name starts in text
+        vector<int> suffixes;                     // positions in text, in sorted suffix order
+        vector<int> suffixBuilding;               // the building each suffix belongs to
+
+        vector<uint32_t> gramKeys;                // every trigram of the names' words, sorted
+        vector<int> gramStart;                    // where each trigram's buildings start in gramBuildings
+        vector<int> gramBuildings;                // the buildings containing each trigram, ascending
+
+        vector<float> popularity;                 // per building; ranks completions
+        vector<int> completions;                  // where name words and abbreviations start in text, sorted
+        vector<int> completionBuilding;           // the building each completion belongs to
+        vector<int> popularTree;                  // segment tree: the most popular completion of each span
+
+        // the building whose name covers a position of text
+        int _BuildingAt(int position) const;
+
+        // the run of suffixes starting with name, ignoring case
+        void _MatchRange(const string& name, const int*& first, const int*& last) const;
+
+        // whether name occurs at position, within building's name, with its capitalization
+        bool _MatchesAt(int position, int building, const string& name) const;
+
+        // a building's lowercased name, within text
+        string_view _NameOf(int building) const;
+
+        // which of two completions ranks first
+        bool _MorePopular(int a, int b) const;
+
+        // the most popular completion in [first, last), or -1 if the span is empty
+        int _MostPopular(int first, int last) const;
+
+    public:
+
+        //
+        // build
+        //
+        // Indexes the buildings. The table must outlive the index and not change
+        // while it is in use. Popularity, if given, has one score per building
+        // for ranking completions; otherwise they come in table order.
+        //
+        void build(const vector<BuildingInfo>& Buildings, const vector<float>& Popularity = {});
+
+        //
+        // findAbbrev
+        //
+        // Returns the position of the first building with this abbreviation, or -1.
+        //
+        int findAbbrev(const string& abbrev) const;
+
+        //
+        // matchName
+        //
+        // Collects the positions of every building whose full name contains name,
+        // case-sensitively, in ascending order.
+        //
+        void matchName(const string& name, vector<int>& matches) const;
+
+        //
+        // findName
+        //
+        // Returns the position of the first building whose full name contains name,
+        // or -1.
+        //
+        int findName(const string& name) const;
+
+        //
+        // find
+        //
+        // The lookup findBuildings() does: by abbreviation, then by partial name.
+        // Returns the building's position, or -1.
+        //
+        int find(const string& query) const;
+
+        //
+        // fuzzyFind
+        //
+        // Collects up to k buildings whose names are closest to query, closest
+        // first. Each word of the query must be within a few edits (more for
+        // longer words) of the start of some word of the name, ignoring case;
+        // buildings where one is not are left out.
+        //
+        void fuzzyFind(const string& query, size_t k, vector<BuildingMatch>& matches) const;
+
+        //
+        // findClosest
+        //
+        // Returns the position of the building fuzzyFind() ranks first, or -1.
+        //
+        int findClosest(const string& query) const;
+
+        //
+        // complete
+        //
+        // Collects up to k buildings to suggest for a prefix being typed: those
+        // whose abbreviation is the prefix come first, then those with an
+        // abbreviation, or a word of their name, starting with the prefix, most
+        // popular first. Ignores case.
+        //
+        void complete(const string& prefix, size_t k, vector<int>& suggestions) const;
+
+        size_t bytes() const;
+};
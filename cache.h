@@ -0,0 +1,202 @@
+// cache.h
+//
+// Bounded, thread-safe least-recently-used cache. Entries are split between
+// several shards by key hash, each with its own lock, so concurrent lookups of
+// different keys rarely wait on each other. Values are handed out as shared
+// pointers to const, so no copy is made while a shard is locked.
+
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+
+using namespace std;
+
+//
+// CacheStats
+//
+// A snapshot of a cache's counters. bytes is an estimate: the sizes reported for
+// the values plus the cache's own per-entry bookkeeping.
+//
+struct CacheStats
+{
+  unsigned long long hits = 0;
+  unsigned long long misses = 0;
+  unsigned long long insertions = 0;
+  unsigned long long evictions = 0;
+  size_t entries = 0;
+  size_t bytes = 0;
+  size_t maxEntries = 0;
+  size_t maxBytes = 0;
+
+  double hitRate() const {
+    unsigned long long lookups = hits + misses;
+    return lookups ? static_cast<double>(hits) / lookups : 0.0;
+  }
+};
+
+template<typename KeyT, typename ValueT, typename HashT = hash<KeyT>>
+class LRUCache {
+    private:
+
+        struct Entry{
+            KeyT key;
+            shared_ptr<const ValueT> value;
+            size_t bytes; // value size plus bookkeeping
+        };
+
+        typedef typename list<Entry>::iterator EntryIt;
+
+        // each shard keeps its entries most recently used first
+        struct Shard{
+            mutex lock;
+            list<Entry> entries;
+            unordered_map<KeyT, EntryIt, HashT> index;
+            size_t bytes = 0;
+        };
+
+        vector<unique_ptr<Shard>> shards;
+        size_t maxEntriesPerShard;
+        size_t maxBytesPerShard;
+        function<size_t(const ValueT&)> sizeOf;
+        HashT hasher;
+
+        atomic<unsigned long long> hits{0}, misses{0}, insertions{0}, evictions{0};
+
+        // list node, hash node and bucket pointer kept for every entry
+        static constexpr size_t entryOverhead = sizeof(Entry) + 2 * sizeof(void*)
+                                              + sizeof(KeyT) + sizeof(EntryIt) + 2 * sizeof(void*);
+
+        Shard& shardFor(const KeyT& key) {
+            return *shards[hasher(key) % shards.size()];
+        }
+
+        //
+        // _EvictLocked
+        // drops least recently used entries until the shard is within its bounds
+        //
+        void _EvictLocked(Shard& shard) {
+            while (!shard.entries.empty() &&
+                   (shard.entries.size() > maxEntriesPerShard || shard.bytes > maxBytesPerShard)){
+
+                Entry& last = shard.entries.back();
+                shard.bytes -= last.bytes;
+                shard.index.erase(last.key);
+                shard.entries.pop_back();
+                evictions++;
+            }
+        }
+
+    public:
+
+        //
+        // constructor:
+        // the cache holds at most maxEntries entries and about maxBytes bytes. The
+        // bounds are split evenly between the shards, so small caches use fewer
+        // shards. sizeOf reports the bytes owned by a value.
+        //
+        LRUCache(size_t maxEntries, size_t maxBytes, function<size_t(const ValueT&)> sizeOf)
+            : sizeOf(sizeOf) {
+
+            size_t numShards = clamp<size_t>(maxEntries / 64, 1, 16);
+
+            for (size_t i = 0; i < numShards; i++){
+                shards.push_back(make_unique<Shard>());
+            }
+
+            maxEntriesPerShard = max<size_t>(1, maxEntries / numShards);
+            maxBytesPerShard = max<size_t>(1, maxBytes / numShards);
+        }
+
+        //
+        // get
+        //
+        // Returns the cached value for key, or nullptr if there is none. A hit
+        // makes the entry the most recently used one.
+        //
+        shared_ptr<const ValueT> get(const KeyT& key) {
+            Shard& shard = shardFor(key);
+            lock_guard<mutex> guard(shard.lock);
+
+            auto found = shard.index.find(key);
+            if (found == shard.index.end()){
+                misses++;
+                return nullptr;
+            }
+
+            shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+            hits++;
+            return found->second->value;
+        }
+
+        //
+        // put
+        //
+        // Stores value under key, replacing any existing entry, and evicts the
+        // least recently used entries if the cache is over its bounds.
+        //
+        void put(const KeyT& key, ValueT value) {
+            size_t bytes = sizeOf(value) + entryOverhead;
+            auto shared = make_shared<const ValueT>(std::move(value));
+
+            Shard& shard = shardFor(key);
+            lock_guard<mutex> guard(shard.lock);
+
+            auto found = shard.index.find(key);
+            if (found != shard.index.end()){
+                shard.bytes -= found->second->bytes;
+                shard.entries.erase(found->second);
+                shard.index.erase(found);
+            }
+
+            shard.entries.push_front(Entry{key, shared, bytes});
+            shard.index[key] = shard.entries.begin();
+            shard.bytes += bytes;
+            insertions++;
+
+            _EvictLocked(shard);
+        }
+
+        //
+        // clear
+        //
+        // Removes every entry. The counters are kept.
+        //
+        void clear() {
+            for (auto& shard : shards){
+                lock_guard<mutex> guard(shard->lock);
+                shard->entries.clear();
+                shard->index.clear();
+                shard->bytes = 0;
+            }
+        }
+
+        //
+        // stats
+        //
+        // Returns the current counters, entry count and size.
+        //
+        CacheStats stats() {
+            CacheStats s;
+            s.hits = hits;
+            s.misses = misses;
+            s.insertions = insertions;
+            s.evictions = evictions;
+            s.maxEntries = maxEntriesPerShard * shards.size();
+            s.maxBytes = maxBytesPerShard * shards.size();
+
+            for (auto& shard : shards){
+                lock_guard<mutex> guard(shard->lock);
+                s.entries += shard->entries.size();
+                s.bytes += shard->bytes;
+            }
+
+            return s;
+        }
+};
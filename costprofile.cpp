@@ -0,0 +1,25 @@
+// costprofile.cpp
+//
+// Names of the cost profiles, as the server and command line take them.
+
+#include "costprofile.h"
+
+using namespace std;
+
+static const char* ProfileNames[NumCostProfiles] = {"distance", "time", "avoid-stairs", "accessible"};
+
+const char* profileName(CostProfile profile){
+    return ProfileNames[static_cast<int>(profile)];
+}
+
+bool parseCostProfile(const string& name, CostProfile& profile){
+
+    for (int p = 0; p < NumCostProfiles; p++){
+        if (name == ProfileNames[p]){
+            profile = static_cast<CostProfile>(p);
+            return true;
+        }
+    }
+
+    return false;
+}
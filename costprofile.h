@@ -0,0 +1,89 @@
+// costprofile.h
+//
+// Cost profiles: what a search minimizes. Distance is the length in miles, as
+// every edge weight is; the others are in minutes of walking, at each way class's
+// speed factor, and differ in how they treat stairs. Each profile is a type, so a
+// search takes it as a template parameter and its inner loop is compiled once per
+// profile, with the cost lookup inlined rather than chosen edge by edge.
+
+#pragma once
+
+#include <string>
+#include <limits>
+
+using namespace std;
+
+enum class CostProfile
+{
+  Distance,     // miles
+  WalkingTime,  // minutes
+  AvoidStairs,  // minutes, with stairs counted StairsAvoidance times over
+  Accessible,   // minutes, never taking stairs
+  NumProfiles
+};
+
+const int NumCostProfiles = static_cast<int>(CostProfile::NumProfiles);
+
+// the profiles besides Distance, whose costs a SearchGraph stores per edge, in
+// an array of their own
+const int CostColumns = NumCostProfiles - 1;
+
+// a steady walk of 3 miles an hour, to turn minutes into distances
+const double WalkingMilesPerMinute = 3.0 / 60;
+
+// how many times longer stairs seem to AvoidStairs than the same walk on the flat
+const double StairsAvoidance = 10;
+
+//
+// DistanceCost, WalkingTimeCost, AvoidStairsCost, AccessibleCost
+//
+// One per profile. Column is where the profile's costs sit among an edge's
+// CostColumns, -1 for Distance, whose costs are the edge weights themselves, and
+// Penalized whether a search workspace's edge factors scale them; of()
+// turns an edge's length, its way class's speed factor and whether it is stairs
+// into its cost. An edge that cannot be taken costs infinity.
+//
+struct DistanceCost
+{
+  static constexpr CostProfile Profile = CostProfile::Distance;
+  static constexpr int Column = -1;
+  static constexpr bool Penalized = false;
+
+  static double of(double miles, double, bool) { return miles; }
+};
+
+struct WalkingTimeCost
+{
+  static constexpr CostProfile Profile = CostProfile::WalkingTime;
+  static constexpr int Column = 0;
+  static constexpr bool Penalized = false;
+
+  static double of(double miles, double speedFactor, bool) { return miles / (WalkingMilesPerMinute * speedFactor); }
+};
+
+struct AvoidStairsCost
+{
+  static constexpr CostProfile Profile = CostProfile::AvoidStairs;
+  static constexpr int Column = 1;
+  static constexpr bool Penalized = false;
+
+  static double of(double miles, double speedFactor, bool stairs){
+    return WalkingTimeCost::of(miles, speedFactor, stairs) * (stairs ? StairsAvoidance : 1);
+  }
+};
+
+struct AccessibleCost
+{
+  static constexpr CostProfile Profile = CostProfile::Accessible;
+  static constexpr int Column = 2;
+  static constexpr bool Penalized = false;
+
+  static double of(double miles, double speedFactor, bool stairs){
+    return stairs ? numeric_limits<double>::infinity() : WalkingTimeCost::of(miles, speedFactor, stairs);
+  }
+};
+
+// "distance", "time", "avoid-stairs" and "accessible"
+const char* profileName(CostProfile profile);
+// returns false, leaving profile unchanged, for a name that is not a profile
+bool parseCostProfile(const string& name, CostProfile& profile);
@@ -12,9 +12,11 @@
 
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 
 #include "dist.h"
 #include "osm.h"
+#include "simd.h"
 
 using namespace std;
 
@@ -85,3 +87,203 @@ Coordinates centerBetween2Points(double lat1, double long1, double lat2, double
   return Coordinates(-1, lat_ret, long_ret);
     
 }
+
+
+//
+// Batch distance kernels
+//
+// The constants and the order of every operation match distBetween2Points(),
+// see dist.h for the tolerance.
+//
+static const double BATCH_PI = 3.14159265;
+static const double BATCH_EARTH_RAD = 3963.1;  // statue miles:
+
+// number of chord lengths computed per pass of nearestVector()
+static const size_t NEAREST_CHUNK = 256;
+
+TrigPoint toTrigPoint(double lat, double lon)
+{
+  double lat_rad = lat * BATCH_PI / 180.0;
+  double lon_rad = lon * BATCH_PI / 180.0;
+
+  return TrigPoint{sin(lat_rad), cos(lat_rad), sin(lon_rad), cos(lon_rad)};
+}
+
+void PointArrays::push_back(double lat, double lon)
+{
+  TrigPoint p = toTrigPoint(lat, lon);
+
+  sinLat.push_back(p.sinLat);
+  cosLat.push_back(p.cosLat);
+  sinLon.push_back(p.sinLon);
+  cosLon.push_back(p.cosLon);
+}
+
+void PointArrays::reserve(size_t n)
+{
+  sinLat.reserve(n);
+  cosLat.reserve(n);
+  sinLon.reserve(n);
+  cosLon.reserve(n);
+}
+
+void PointArrays::clear()
+{
+  sinLat.clear();
+  cosLat.clear();
+  sinLon.clear();
+  cosLon.clear();
+}
+
+void distToPoint(const PointArrays& from, const TrigPoint& to, double* out)
+{
+  const double* cosLat = from.cosLat.data();
+  const double* cosLon = from.cosLon.data();
+  const double* sinLon = from.sinLon.data();
+  const double* sinLat = from.sinLat.data();
+  size_t n = from.size();
+
+  SimdDouble cl2 = SimdDouble::set1(to.cosLat), cL2 = SimdDouble::set1(to.cosLon);
+  SimdDouble sL2 = SimdDouble::set1(to.sinLon), sl2 = SimdDouble::set1(to.sinLat);
+
+  size_t i = 0;
+  for (; i + SimdDouble::Width <= n; i += SimdDouble::Width)
+  {
+    SimdDouble cl1 = SimdDouble::load(cosLat + i);
+
+    SimdDouble dot = (cl1 * SimdDouble::load(cosLon + i) * cl2 * cL2)
+                   + (cl1 * SimdDouble::load(sinLon + i) * cl2 * sL2)
+                   + (SimdDouble::load(sinLat + i) * sl2);
+    dot.store(out + i);
+  }
+
+  for (; i < n; i++)
+  {
+    out[i] = (cosLat[i] * cosLon[i] * to.cosLat * to.cosLon)
+           + (cosLat[i] * sinLon[i] * to.cosLat * to.sinLon)
+           + (sinLat[i] * to.sinLat);
+  }
+
+  for (i = 0; i < n; i++)
+  {
+    out[i] = BATCH_EARTH_RAD * acos(out[i]);
+  }
+}
+
+void distBetweenPairs(const PointArrays& a, size_t aBegin, const PointArrays& b, size_t bBegin,
+                      size_t count, double* out)
+{
+  const double* cosLat1 = a.cosLat.data() + aBegin;
+  const double* cosLon1 = a.cosLon.data() + aBegin;
+  const double* sinLon1 = a.sinLon.data() + aBegin;
+  const double* sinLat1 = a.sinLat.data() + aBegin;
+  const double* cosLat2 = b.cosLat.data() + bBegin;
+  const double* cosLon2 = b.cosLon.data() + bBegin;
+  const double* sinLon2 = b.sinLon.data() + bBegin;
+  const double* sinLat2 = b.sinLat.data() + bBegin;
+
+  size_t i = 0;
+  for (; i + SimdDouble::Width <= count; i += SimdDouble::Width)
+  {
+    SimdDouble cl1 = SimdDouble::load(cosLat1 + i);
+    SimdDouble cl2 = SimdDouble::load(cosLat2 + i);
+
+    SimdDouble dot = (cl1 * SimdDouble::load(cosLon1 + i) * cl2 * SimdDouble::load(cosLon2 + i))
+                   + (cl1 * SimdDouble::load(sinLon1 + i) * cl2 * SimdDouble::load(sinLon2 + i))
+                   + (SimdDouble::load(sinLat1 + i) * SimdDouble::load(sinLat2 + i));
+    dot.store(out + i);
+  }
+
+  for (; i < count; i++)
+  {
+    out[i] = (cosLat1[i] * cosLon1[i] * cosLat2[i] * cosLon2[i])
+           + (cosLat1[i] * sinLon1[i] * cosLat2[i] * sinLon2[i])
+           + (sinLat1[i] * sinLat2[i]);
+  }
+
+  for (i = 0; i < count; i++)
+  {
+    out[i] = BATCH_EARTH_RAD * acos(out[i]);
+  }
+}
+
+
+//
+// Unit vectors
+//
+UnitVector toUnitVector(double lat, double lon)
+{
+  TrigPoint p = toTrigPoint(lat, lon);
+
+  return UnitVector{p.cosLat * p.cosLon, p.cosLat * p.sinLon, p.sinLat};
+}
+
+void UnitVectorArrays::push_back(const UnitVector& v)
+{
+  x.push_back(v.x);
+  y.push_back(v.y);
+  z.push_back(v.z);
+}
+
+void UnitVectorArrays::reserve(size_t n)
+{
+  x.reserve(n);
+  y.reserve(n);
+  z.reserve(n);
+}
+
+double distBetweenVectors(const UnitVector& a, const UnitVector& b)
+{
+  double dot = a.x * b.x + a.y * b.y + a.z * b.z;
+
+  return BATCH_EARTH_RAD * acos(max(-1.0, min(1.0, dot)));
+}
+
+size_t nearestVector(const UnitVector& from, const UnitVectorArrays& to, double& closestDist)
+{
+  double chords[NEAREST_CHUNK];
+
+  SimdDouble fx = SimdDouble::set1(from.x), fy = SimdDouble::set1(from.y), fz = SimdDouble::set1(from.z);
+
+  size_t closest = 0;
+  double closestChord = 0;
+
+  for (size_t begin = 0; begin < to.size(); begin += NEAREST_CHUNK)
+  {
+    size_t count = min(NEAREST_CHUNK, to.size() - begin);
+    const double* x = to.x.data() + begin;
+    const double* y = to.y.data() + begin;
+    const double* z = to.z.data() + begin;
+
+    // squared chord lengths of the chunk
+    size_t i = 0;
+    for (; i + SimdDouble::Width <= count; i += SimdDouble::Width)
+    {
+      SimdDouble dx = SimdDouble::load(x + i) - fx;
+      SimdDouble dy = SimdDouble::load(y + i) - fy;
+      SimdDouble dz = SimdDouble::load(z + i) - fz;
+
+      (dx * dx + dy * dy + dz * dz).store(chords + i);
+    }
+
+    for (; i < count; i++)
+    {
+      double dx = x[i] - from.x, dy = y[i] - from.y, dz = z[i] - from.z;
+      chords[i] = dx * dx + dy * dy + dz * dz;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+      if ((begin + i == 0) || chords[i] < closestChord)
+      {
+        closest = begin + i;
+        closestChord = chords[i];
+      }
+    }
+  }
+
+  UnitVector best{to.x[closest], to.y[closest], to.z[closest]};
+  closestDist = distBetweenVectors(from, best);
+
+  return closest;
+}
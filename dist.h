@@ -10,11 +10,114 @@
 // University of Illinois at Chicago
 //
 
+#pragma once
+
 #include <iostream>
 #include <cmath>
+#include <vector>
 #include "osm.h"
 
 using namespace std;
 
 double distBetween2Points(double lat1, double long1, double lat2, double long2);
 Coordinates centerBetween2Points(double lat1, double long1, double lat2, double long2);
+
+
+//
+// Batch distance kernels
+//
+// The same great-circle distance as distBetween2Points(), evaluated for many
+// points at once. Points are stored as struct-of-arrays with the sines and
+// cosines of their latitude and longitude computed once, and the per-point
+// work is vectorized with SimdDouble (see simd.h); only acos is left scalar.
+//
+// Tolerance: every product and sum is evaluated in the same order as in
+// distBetween2Points(), so results are bit-identical to it when the compiler
+// does not contract multiply-adds into FMAs (the default flags do not). If FMA
+// contraction is enabled, the cosine of the angle can differ by a few ulps,
+// and the distance by at most earth_rad * sqrt(2 * 4.4e-16), about 1e-4
+// miles for points a few feet apart and far less beyond that.
+//
+
+//
+// TrigPoint
+//
+// One point's (lat, lon) as sines and cosines.
+//
+struct TrigPoint
+{
+  double sinLat;
+  double cosLat;
+  double sinLon;
+  double cosLon;
+};
+
+//
+// PointArrays
+//
+// Many points' (lat, lon) as sines and cosines, one array per component.
+//
+struct PointArrays
+{
+  vector<double> sinLat;
+  vector<double> cosLat;
+  vector<double> sinLon;
+  vector<double> cosLon;
+
+  size_t size() const { return sinLat.size(); }
+  void push_back(double lat, double lon);
+  void reserve(size_t n);
+  void clear();
+};
+
+TrigPoint toTrigPoint(double lat, double lon);
+
+// out[i] = distance from point i of `from` to `to`, for every point
+void distToPoint(const PointArrays& from, const TrigPoint& to, double* out);
+
+// out[i] = distance from point aBegin + i of a to point bBegin + i of b, for count points
+void distBetweenPairs(const PointArrays& a, size_t aBegin, const PointArrays& b, size_t bBegin,
+                      size_t count, double* out);
+
+
+//
+// Unit vectors
+//
+// A point as the (x, y, z) unit vector from the earth's center. Positions that
+// never change are converted once; after that the distance between two points
+// is a dot product and one acos, and ranking points by distance needs no trig
+// at all: the squared chord length |p - q|^2 grows with the distance and, unlike
+// the dot product, stays accurate for points only feet apart.
+//
+struct UnitVector
+{
+  double x;
+  double y;
+  double z;
+};
+
+//
+// UnitVectorArrays
+//
+// Many unit vectors, one array per component.
+//
+struct UnitVectorArrays
+{
+  vector<double> x;
+  vector<double> y;
+  vector<double> z;
+
+  size_t size() const { return x.size(); }
+  void push_back(const UnitVector& v);
+  void reserve(size_t n);
+};
+
+UnitVector toUnitVector(double lat, double lon);
+
+// distance in miles between two unit vectors; the cosine is clamped to [-1, 1] so
+// equal points are 0 miles apart rather than NaN
+double distBetweenVectors(const UnitVector& a, const UnitVector& b);
+
+// index of the point of `to` closest to `from` by chord length, keeping the earliest
+// of equally close points; closestDist is set to its distance. `to` must not be empty.
+size_t nearestVector(const UnitVector& from, const UnitVectorArrays& to, double& closestDist);
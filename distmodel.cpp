@@ -0,0 +1,85 @@
+// distmodel.cpp
+//
+// Naming and automatic selection of distance models.
+
+#include <string>
+#include <vector>
+
+#include "distmodel.h"
+
+using namespace std;
+
+const char* distanceModelName(DistanceModel model){
+
+    switch (model){
+        case DistanceModel::SphericalCosines: return "cosines";
+        case DistanceModel::Haversine:        return "haversine";
+        case DistanceModel::Equirectangular:  return "planar";
+        default:                              return "auto";
+    }
+}
+
+bool parseDistanceModel(const string& name, DistanceModel& model){
+
+    for (DistanceModel m : {DistanceModel::SphericalCosines, DistanceModel::Haversine,
+                            DistanceModel::Equirectangular, DistanceModel::Auto}){
+        if (name == distanceModelName(m)){
+            model = m;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+DistanceModel chooseDistanceModel(const NodeStore& Nodes, double maxRelError,
+                                  Equirectangular& planar, double& worstRelError){
+
+    worstRelError = 0;
+
+    if (Nodes.empty()){
+        planar = Equirectangular();
+        return DistanceModel::Equirectangular;
+    }
+
+    // bounding box of the map
+    double minLat = Nodes.latOf(0), maxLat = minLat;
+    double minLon = Nodes.lonOf(0), maxLon = minLon;
+
+    for (int i = 1; i < Nodes.size(); i++){
+        minLat = min(minLat, Nodes.latOf(i));
+        maxLat = max(maxLat, Nodes.latOf(i));
+        minLon = min(minLon, Nodes.lonOf(i));
+        maxLon = max(maxLon, Nodes.lonOf(i));
+    }
+
+    planar = Equirectangular((minLat + maxLat) / 2);
+
+    // the projection is worst for long lines near the box's edges, so compare
+    // every pair of points on a grid spanning the whole box
+    const int Steps = 6;
+    Haversine haversine;
+    vector<pair<Haversine::Point, Equirectangular::Point>> samples;
+
+    for (int i = 0; i <= Steps; i++){
+        for (int j = 0; j <= Steps; j++){
+            double lat = minLat + (maxLat - minLat) * i / Steps;
+            double lon = minLon + (maxLon - minLon) * j / Steps;
+
+            samples.push_back(pair(haversine.prepare(lat, lon), planar.prepare(lat, lon)));
+        }
+    }
+
+    for (size_t a = 0; a < samples.size(); a++){
+        for (size_t b = a + 1; b < samples.size(); b++){
+
+            double exact = haversine.distance(samples[a].first, samples[b].first);
+            if (exact <= 0) continue;
+
+            double approx = planar.distance(samples[a].second, samples[b].second);
+            worstRelError = max(worstRelError, fabs(approx - exact) / exact);
+        }
+    }
+
+    return worstRelError <= maxRelError ? DistanceModel::Equirectangular : DistanceModel::Haversine;
+}
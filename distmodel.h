@@ -0,0 +1,186 @@
+// distmodel.h
+//
+// Distance models: interchangeable ways of computing the distance between two
+// points, written as policy classes so that code templated on a model (graph
+// edge weighting, nearest-node search) gets its inner loop specialized and
+// inlined for that model. Every model provides
+//
+//    Point                          a point prepared for the model
+//    Arrays                         many Points, one array per component
+//    Point prepare(lat, lon)        converts a position, once per point
+//    double distance(Point, Point)  the distance in miles
+//    size_t nearest(Point, Arrays)  index of the closest point, earliest on ties
+//
+// SphericalCosines is the formula distBetween2Points() has always used (in unit
+// vector form). It is noisy for points a few feet apart, since acos is badly
+// conditioned near 1. Haversine is the same great-circle distance computed from
+// the chord length instead, accurate at every scale for the same cost.
+// Equirectangular projects onto a plane around a reference latitude: cheapest,
+// and accurate for maps a few miles across, which is what chooseDistanceModel()
+// checks before picking it.
+
+#pragma once
+
+#include <vector>
+#include <map>
+#include <cmath>
+#include <algorithm>
+
+#include "osm.h"
+#include "dist.h"
+#include "simd.h"
+#include "nodestore.h"
+
+using namespace std;
+
+enum class DistanceModel
+{
+  SphericalCosines,
+  Haversine,
+  Equirectangular,
+  Auto  // pick the cheapest model within the error bound when the map is loaded
+};
+
+//
+// SphericalCosines
+//
+// Spherical law of cosines: R * acos(a . b) on unit vectors.
+//
+struct SphericalCosines
+{
+  typedef UnitVector Point;
+  typedef UnitVectorArrays Arrays;
+
+  Point prepare(double lat, double lon) const { return toUnitVector(lat, lon); }
+
+  double distance(const Point& a, const Point& b) const { return distBetweenVectors(a, b); }
+
+  size_t nearest(const Point& from, const Arrays& to) const {
+    double closestDist;
+    return nearestVector(from, to, closestDist);
+  }
+};
+
+//
+// Haversine
+//
+// Haversine formula. On unit vectors, hav(angle) = chord^2 / 4, so the distance
+// is 2R * asin(chord / 2). Ranking by chord length is exact, so the nearest
+// point search is shared with SphericalCosines.
+//
+struct Haversine
+{
+  typedef UnitVector Point;
+  typedef UnitVectorArrays Arrays;
+
+  static constexpr double EarthRadius = 3963.1;  // statue miles, as in dist.cpp
+
+  Point prepare(double lat, double lon) const { return toUnitVector(lat, lon); }
+
+  double distance(const Point& a, const Point& b) const {
+    double dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+    double chord = sqrt(dx * dx + dy * dy + dz * dz);
+
+    return 2 * EarthRadius * asin(min(1.0, chord / 2));
+  }
+
+  size_t nearest(const Point& from, const Arrays& to) const {
+    double closestDist;
+    return nearestVector(from, to, closestDist);
+  }
+};
+
+//
+// Equirectangular
+//
+// Projects (lat, lon) onto the plane x = lon * cos(reference latitude), y = lat
+// (in radians), and measures straight lines there. The error grows with the
+// map's extent and with distance from the reference latitude.
+//
+struct Equirectangular
+{
+  struct Point
+  {
+    double x;
+    double y;
+  };
+
+  struct Arrays
+  {
+    vector<double> x;
+    vector<double> y;
+
+    size_t size() const { return x.size(); }
+    void push_back(const Point& p) { x.push_back(p.x); y.push_back(p.y); }
+    void reserve(size_t n) { x.reserve(n); y.reserve(n); }
+  };
+
+  static constexpr double EarthRadius = 3963.1;  // statue miles, as in dist.cpp
+  static constexpr double Radians = 3.14159265 / 180.0;
+
+  double cosRefLat = 1.0;
+
+  Equirectangular() {}
+  explicit Equirectangular(double refLat) : cosRefLat(cos(refLat * Radians)) {}
+
+  Point prepare(double lat, double lon) const { return Point{lon * Radians * cosRefLat, lat * Radians}; }
+
+  double distance(const Point& a, const Point& b) const {
+    double dx = a.x - b.x, dy = a.y - b.y;
+    return EarthRadius * sqrt(dx * dx + dy * dy);
+  }
+
+  size_t nearest(const Point& from, const Arrays& to) const {
+    const size_t Chunk = 256;
+    double squares[Chunk];
+
+    SimdDouble fx = SimdDouble::set1(from.x), fy = SimdDouble::set1(from.y);
+
+    size_t closest = 0;
+    double closestSquare = 0;
+
+    for (size_t begin = 0; begin < to.size(); begin += Chunk){
+
+      size_t count = min(Chunk, to.size() - begin);
+      const double* x = to.x.data() + begin;
+      const double* y = to.y.data() + begin;
+
+      size_t i = 0;
+      for (; i + SimdDouble::Width <= count; i += SimdDouble::Width){
+        SimdDouble dx = SimdDouble::load(x + i) - fx;
+        SimdDouble dy = SimdDouble::load(y + i) - fy;
+        (dx * dx + dy * dy).store(squares + i);
+      }
+
+      for (; i < count; i++){
+        double dx = x[i] - from.x, dy = y[i] - from.y;
+        squares[i] = dx * dx + dy * dy;
+      }
+
+      for (i = 0; i < count; i++){
+        if (begin + i == 0 || squares[i] < closestSquare){
+          closest = begin + i;
+          closestSquare = squares[i];
+        }
+      }
+    }
+
+    return closest;
+  }
+};
+
+const char* distanceModelName(DistanceModel model);
+
+// parses "cosines", "haversine", "planar" or "auto"; returns false otherwise
+bool parseDistanceModel(const string& name, DistanceModel& model);
+
+//
+// chooseDistanceModel
+//
+// Returns the cheapest model whose distances are within maxRelError (relative)
+// of the haversine distance everywhere on the map, found by comparing distances
+// between points spread over the map's bounding box. planar is set up with the
+// map's middle latitude as its reference either way.
+//
+DistanceModel chooseDistanceModel(const NodeStore& Nodes, double maxRelError,
+                                  Equirectangular& planar, double& worstRelError);
@@ -0,0 +1,142 @@
+// engine.cpp
+//
+// Implementation of the QueryEngine thread pool.
+
+#include "engine.h"
+
+using namespace std;
+
+QueryEngine::QueryEngine(shared_ptr<const MapData> data, unsigned numThreads, size_t cacheEntries, size_t cacheBytes)
+    : cacheEntries(cacheEntries), cacheBytes(cacheBytes) {
+
+    auto first = make_shared<ServingMap>();
+    first->data = std::move(data);
+    if (cacheEntries > 0){
+        first->cache = make_unique<MeetingCache>(cacheEntries, cacheBytes, meetingResultBytes);
+    }
+    serving.store(std::move(first));
+
+    if (numThreads == 0){
+        numThreads = max(1u, thread::hardware_concurrency());
+    }
+
+    // workspaces are created before any worker starts, so the vector never reallocates under them
+    workspaces.resize(numThreads);
+
+    for (unsigned i = 0; i < numThreads; i++){
+        workers.emplace_back(&QueryEngine::workerLoop, this, i);
+    }
+}
+
+QueryEngine::~QueryEngine(){
+
+    {
+        lock_guard<mutex> guard(tasksLock);
+        stopping = true;
+    }
+    tasksReady.notify_all();
+
+    for (thread& worker : workers){
+        worker.join();
+    }
+}
+
+/*function run by each worker thread: takes tasks off the queue until the engine stops
+Takes 1 parameter:
+    id: the index of the worker, and of its workspace
+No returns*/
+void QueryEngine::workerLoop(int id){
+
+    SearchWorkspace& ws = workspaces[id];
+
+    while (true){
+
+        function<void(const ServingMap&, SearchWorkspace&)> task;
+
+        {
+            unique_lock<mutex> guard(tasksLock);
+            tasksReady.wait(guard, [this]{ return stopping || !tasks.empty(); });
+
+            if (tasks.empty()) return; // stopping, and nothing left to do
+
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+
+        // held until the task is done, even if the map is swapped meanwhile
+        shared_ptr<const ServingMap> map = serving.load();
+
+        task(*map, ws);
+    }
+}
+
+unsigned QueryEngine::swapMap(shared_ptr<const MapData> data){
+
+    auto next = make_shared<ServingMap>();
+    next->data = std::move(data);
+    if (cacheEntries > 0){
+        next->cache = make_unique<MeetingCache>(cacheEntries, cacheBytes, meetingResultBytes);
+    }
+
+    // only the map's owner swaps, so reading the old version here does not race another swap
+    next->version = serving.load()->version + 1;
+    unsigned version = next->version;
+
+    serving.store(std::move(next));
+    return version;
+}
+
+void QueryEngine::post(function<void(const ServingMap&, SearchWorkspace&)> task){
+
+    {
+        lock_guard<mutex> guard(tasksLock);
+        tasks.push(std::move(task));
+    }
+    tasksReady.notify_one();
+}
+
+MeetingResult QueryEngine::meet(const ServingMap& map, const string& person1Building, const string& person2Building,
+                               SearchWorkspace& ws){
+
+    if (!queryTracer){
+        return findMeetingPoint(*map.data, person1Building, person2Building, ws, map.cache.get());
+    }
+
+    QueryTrace trace(person1Building, person2Building);
+    MeetingResult result = findMeetingPoint(*map.data, person1Building, person2Building, ws, map.cache.get(), &trace);
+    queryTracer->record(trace);
+
+    return result;
+}
+
+future<MeetingResult> QueryEngine::submit(const string& person1Building, const string& person2Building){
+
+    auto job = make_shared<packaged_task<MeetingResult(const ServingMap&, SearchWorkspace&)>>(
+        [this, person1Building, person2Building](const ServingMap& map, SearchWorkspace& ws){
+            return meet(map, person1Building, person2Building, ws);
+        });
+
+    future<MeetingResult> result = job->get_future();
+    post([job](const ServingMap& map, SearchWorkspace& ws){ (*job)(map, ws); });
+
+    return result;
+}
+
+vector<MeetingResult> QueryEngine::runBatch(const vector<pair<string, string>>& queries){
+
+    vector<future<MeetingResult>> pending;
+    pending.reserve(queries.size());
+
+    for (const auto& query : queries){
+        pending.push_back(submit(query.first, query.second));
+    }
+
+    vector<MeetingResult> results;
+    results.reserve(queries.size());
+
+    for (future<MeetingResult>& f : pending){
+        results.push_back(f.get());
+    }
+
+    return results;
+}
@@ -0,0 +1,137 @@
+// engine.h
+//
+// Thread pool that answers meeting point queries against one shared MapData.
+// The map is only ever read, and each worker thread owns its own SearchWorkspace,
+// so the only lock taken is the one guarding the task queue.
+//
+// The map is held as a reference-counted snapshot that can be swapped for a newly
+// loaded one at any time. Each task takes the current snapshot when it starts and
+// keeps it until it finishes, so queries already running complete on the old map
+// and the old map is freed once the last of them is done.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+
+#include "mapdata.h"
+#include "query.h"
+
+using namespace std;
+
+//
+// ServingMap
+//
+// One version of the map and the result cache that goes with it; cached results
+// never outlive the map they were computed on.
+//
+struct ServingMap
+{
+  shared_ptr<const MapData> data;
+  unique_ptr<MeetingCache> cache; // null when caching is off
+  unsigned version = 1;
+};
+
+class QueryEngine {
+    private:
+
+        atomic<shared_ptr<const ServingMap>> serving;
+        size_t cacheEntries;
+        size_t cacheBytes;
+        QueryTracer* queryTracer = nullptr;
+
+        vector<thread> workers;
+        vector<SearchWorkspace> workspaces; // workspaces[i] belongs to workers[i]
+
+        queue<function<void(const ServingMap&, SearchWorkspace&)>> tasks;
+        mutex tasksLock;
+        condition_variable tasksReady;
+        bool stopping = false;
+
+        void workerLoop(int id);
+
+    public:
+
+        //
+        // constructor:
+        // starts numThreads workers; 0 uses one per hardware thread. If cacheEntries
+        // is not 0, meeting results are cached, up to cacheEntries results and
+        // about cacheBytes bytes.
+        //
+        QueryEngine(shared_ptr<const MapData> data, unsigned numThreads = 0,
+                    size_t cacheEntries = 0, size_t cacheBytes = 64 << 20);
+
+        QueryEngine(const QueryEngine&) = delete;
+        QueryEngine& operator=(const QueryEngine&) = delete;
+
+        //
+        // destructor:
+        // finishes the queued queries, then joins the workers
+        //
+        ~QueryEngine();
+
+        int numWorkers() const { return static_cast<int>(workers.size()); }
+
+        // the map new queries run on, with its result cache
+        shared_ptr<const ServingMap> current() const { return serving.load(); }
+
+        //
+        // swapMap
+        //
+        // Makes data the map for every query started from now on, with an empty
+        // result cache, and returns its version number.
+        //
+        unsigned swapMap(shared_ptr<const MapData> data);
+
+        //
+        // post
+        //
+        // Queues an arbitrary task; it is run on a worker thread with the map
+        // current when it starts and that worker's workspace.
+        //
+        void post(function<void(const ServingMap&, SearchWorkspace&)> task);
+
+        //
+        // setTracer
+        //
+        // Traces every meeting query queued from now on into tracer, or stops
+        // tracing if it is null. Set it while no query is running; the tracer
+        // must outlive the engine.
+        //
+        void setTracer(QueryTracer* tracer) { queryTracer = tracer; }
+
+        // the tracer meeting queries are traced into, null when tracing is off
+        QueryTracer* tracer() const { return queryTracer; }
+
+        //
+        // meet
+        //
+        // Answers a meeting point query on the calling worker, with map's result
+        // cache and the engine's tracer.
+        //
+        MeetingResult meet(const ServingMap& map, const string& person1Building, const string& person2Building,
+                           SearchWorkspace& ws);
+
+        //
+        // submit
+        //
+        // Queues a meeting point query and returns a future for its result.
+        //
+        future<MeetingResult> submit(const string& person1Building, const string& person2Building);
+
+        //
+        // runBatch
+        //
+        // Answers every (person 1, person 2) query across the pool, and returns
+        // the results in the same order as the queries.
+        //
+        vector<MeetingResult> runBatch(const vector<pair<string, string>>& queries);
+};
@@ -0,0 +1,279 @@
+// footprint.cpp
+//
+// Sizes of the map's structures, and the resident set of the process.
+
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "footprint.h"
+#include "mapdata.h"
+
+using namespace std;
+
+size_t mallocChunkBytes(size_t n){
+
+    // blocks above the mmap threshold get whole pages of their own
+    const size_t mmapThreshold = 128 * 1024;
+    const size_t page = 4096;
+
+    if (n >= mmapThreshold){
+        return (n + 2 * sizeof(size_t) + page - 1) / page * page;
+    }
+
+    // a size field before the block, rounded up to 16 bytes, and never under 32
+    return max<size_t>(32, (n + sizeof(size_t) + 15) / 16 * 16);
+}
+
+/*function adds the tinyxml2 pool blocks holding count items of ItemSize bytes to a footprint
+Takes 2 parameters:
+    1. footprint: the footprint to add to
+    2. count: the number of items allocated from the pool
+No returns*/
+template<size_t ItemSize>
+static void addPool(Footprint& footprint, size_t count){
+
+    size_t itemsPerBlock = MemPoolT<ItemSize>::ITEMS_PER_BLOCK;
+    size_t blocks = (count + itemsPerBlock - 1) / itemsPerBlock;
+
+    footprint.bytes += blocks * itemsPerBlock * ItemSize;
+    footprint.overhead += blocks * mallocOverhead(itemsPerBlock * ItemSize);
+}
+
+Footprint xmlFootprint(const XMLDocument& xmldoc, size_t bufferBytes){
+
+    // declarations and other nodes come from the comment pool
+    size_t elements = 0, attributes = 0, texts = 0, others = 0;
+    vector<const XMLNode*> pending = {&xmldoc};
+
+    while (!pending.empty()){
+        const XMLNode* node = pending.back();
+        pending.pop_back();
+
+        for (const XMLNode* child = node->FirstChild(); child; child = child->NextSibling()){
+
+            if (const XMLElement* element = child->ToElement()){
+                elements++;
+                for (const XMLAttribute* a = element->FirstAttribute(); a; a = a->Next()) attributes++;
+            }
+            else if (child->ToText()){
+                texts++;
+            }
+            else{
+                others++;
+            }
+
+            if (child->FirstChild()) pending.push_back(child);
+        }
+    }
+
+    Footprint footprint{"XMLDocument", elements + texts + others};
+
+    footprint.bytes = bufferBytes ? bufferBytes + 1 : 0;
+    footprint.overhead = mallocOverhead(footprint.bytes);
+
+    addPool<sizeof(XMLElement)>(footprint, elements);
+    addPool<sizeof(XMLAttribute)>(footprint, attributes);
+    addPool<sizeof(XMLText)>(footprint, texts);
+    addPool<sizeof(XMLComment)>(footprint, others);
+
+    return footprint;
+}
+
+/*function adds a string's heap block, if it is too long to be kept inside the string, to a footprint
+Takes 2 parameters:
+    1. footprint: the footprint to add to
+    2. s: the string
+No returns*/
+static void addString(Footprint& footprint, const string& s){
+
+    if (s.capacity() > string().capacity()){
+        footprint.bytes += s.capacity() + 1;
+        footprint.overhead += mallocOverhead(s.capacity() + 1);
+    }
+}
+
+vector<Footprint> mapFootprints(const MapData& data){
+
+    vector<Footprint> footprints;
+
+    footprints.push_back(Footprint{"Nodes", static_cast<size_t>(data.Nodes.size()), data.Nodes.bytes()});
+
+    Footprint footways{"Footways", data.Footways.size()};
+    addVector(footways, data.Footways);
+    for (const FootwayInfo& footway : data.Footways) addVector(footways, footway.Nodes);
+    footprints.push_back(footways);
+
+    Footprint buildings{"Buildings", data.Buildings.size()};
+    addVector(buildings, data.Buildings);
+    for (const BuildingInfo& building : data.Buildings){
+        addString(buildings, building.Fullname);
+        addString(buildings, building.Abbrev);
+    }
+    footprints.push_back(buildings);
+
+    Footprint outlines{"BuildingOutlines", data.BuildingOutlines.size()};
+    addVector(outlines, data.BuildingOutlines);
+    for (const vector<long long>& outline : data.BuildingOutlines) addVector(outlines, outline);
+    footprints.push_back(outlines);
+
+    footprints.push_back(Footprint{"BuildingNames", data.Buildings.size(), data.BuildingNames.bytes()});
+
+    Footprint points{"nearest-node arrays", data.FootwayNodeIds.size()};
+    addVector(points, data.FootwayNodeIds);
+    addVector(points, data.FootwayVectors.x);
+    addVector(points, data.FootwayVectors.y);
+    addVector(points, data.FootwayVectors.z);
+    addVector(points, data.FootwayPlanar.x);
+    addVector(points, data.FootwayPlanar.y);
+    addVector(points, data.BuildingPoints.sinLat);
+    addVector(points, data.BuildingPoints.cosLat);
+    addVector(points, data.BuildingPoints.sinLon);
+    addVector(points, data.BuildingPoints.cosLon);
+    addVector(points, data.BuildingAccess);
+    addVector(points, data.AccessOffsets);
+    addVector(points, data.AccessBuildings);
+    footprints.push_back(points);
+
+    graphFootprints(data.G, footprints);
+
+    Footprint search{"Search", static_cast<size_t>(data.Search.numEdges())};
+    addVector(search, data.Search.vertexIds);
+    addVector(search, data.Search.offsets);
+    addVector(search, data.Search.targets);
+    addVector(search, data.Search.weights);
+    addVector(search, data.Search.costs);
+    addVector(search, data.Search.edgeClasses);
+    footprints.push_back(search);
+
+    footprints.push_back(Footprint{"Trees", static_cast<size_t>(data.Trees.numTrees()), data.Trees.bytes()});
+
+    return footprints;
+}
+
+void printFootprints(ostream& out, const vector<Footprint>& footprints){
+
+    out << "Memory (KiB):" << endl;
+    out << left << setw(24) << "  structure" << right << setw(12) << "count" << setw(12) << "bytes"
+        << setw(12) << "overhead" << setw(12) << "total" << endl;
+
+    Footprint sum{"total"};
+    for (const Footprint& f : footprints){
+        sum.bytes += f.bytes;
+        sum.overhead += f.overhead;
+    }
+
+    auto row = [&out](const Footprint& f, bool showCount){
+        out << left << setw(24) << ("  " + f.name) << right << setw(12);
+        if (showCount) out << f.count; else out << "";
+        out << setw(12) << (f.bytes + 512) / 1024 << setw(12) << (f.overhead + 512) / 1024
+            << setw(12) << (f.total() + 512) / 1024 << endl;
+    };
+
+    for (const Footprint& f : footprints) row(f, true);
+    row(sum, false);
+}
+
+void writeFootprintsJson(ostream& out, const vector<Footprint>& footprints){
+
+    out << "[";
+
+    for (size_t i = 0; i < footprints.size(); i++){
+        const Footprint& f = footprints[i];
+
+        out << (i ? "," : "") << "{\"name\":\"" << f.name << "\",\"count\":" << f.count << ",\"bytes\":" << f.bytes
+            << ",\"overhead\":" << f.overhead << ",\"total\":" << f.total() << "}";
+    }
+
+    out << "]";
+}
+
+long residentKiB(){
+
+    long pages = 0, resident = 0;
+    ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+long peakResidentKiB(){
+
+    // VmHWM follows resets of the peak; ru_maxrss never goes down
+    ifstream status("/proc/self/status");
+    string field;
+
+    while (status >> field){
+        if (field == "VmHWM:"){
+            long kib = 0;
+            status >> kib;
+            return kib;
+        }
+        status.ignore(256, '\n');
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+void releaseFreeMemory(){
+
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+}
+
+MemoryPhases::MemoryPhases(){
+    peakResets = _ResetPeak();
+}
+
+/*function resets the kernel's record of the peak resident set to the current one
+Returns false if it could not be reset*/
+bool MemoryPhases::_ResetPeak(){
+
+    ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+    clearRefs.flush();
+
+    return static_cast<bool>(clearRefs);
+}
+
+void MemoryPhases::mark(const string& phase){
+
+    phases.push_back(PhaseMemory{phase, residentKiB(), peakResidentKiB()});
+    if (peakResets) _ResetPeak();
+}
+
+void MemoryPhases::print(ostream& out) const {
+
+    out << "Resident set by phase (KiB" << (peakResets ? "" : "; peaks are cumulative") << "):" << endl;
+    out << left << setw(26) << "  phase" << right << setw(12) << "after" << setw(12) << "peak" << endl;
+
+    for (const PhaseMemory& p : phases){
+        out << left << setw(26) << ("  " + p.phase) << right << setw(12) << p.residentKiB << setw(12) << p.peakKiB << endl;
+    }
+
+    for (const Footprint& f : freed){
+        out << "  freed " << f.name << ": " << (f.total() + 512) / 1024 << " KiB" << endl;
+    }
+}
+
+void MemoryPhases::writeJson(ostream& out) const {
+
+    out << "{\"peaksArePerPhase\":" << (peakResets ? "true" : "false") << ",\"phases\":[";
+
+    for (size_t i = 0; i < phases.size(); i++){
+        out << (i ? "," : "") << "{\"phase\":\"" << phases[i].phase << "\",\"residentKiB\":" << phases[i].residentKiB
+            << ",\"peakKiB\":" << phases[i].peakKiB << "}";
+    }
+
+    out << "],\"freed\":";
+    writeFootprintsJson(out, freed);
+    out << "}";
+}
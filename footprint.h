@@ -0,0 +1,161 @@
+// footprint.h
+//
+// Memory accounting for the loaded map: how many bytes each structure holds,
+// and how much the process's resident set grows and peaks during each phase of
+// loading. Structure sizes count capacity, not just what is in use, and add an
+// estimate of what the allocator spends on top: glibc's per-chunk header and
+// rounding for every heap block, and the tree node around every std::map entry.
+// Resident sizes come from /proc, so they are only reported on Linux.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "tinyxml2.h"
+#include "graph.h"
+
+using namespace std;
+using namespace tinyxml2;
+
+struct MapData;
+
+//
+// Footprint
+//
+// The memory of one structure. count is its elements (nodes, footways, edges);
+// bytes is what it holds, and overhead the allocator's estimated share on top.
+//
+struct Footprint
+{
+  string name;
+  size_t count = 0;
+  size_t bytes = 0;
+  size_t overhead = 0;
+
+  size_t total() const { return bytes + overhead; }
+};
+
+// the bytes glibc malloc takes from the heap for a request of n bytes
+size_t mallocChunkBytes(size_t n);
+
+// the estimated overhead of one heap block of n bytes, 0 when nothing is allocated
+inline size_t mallocOverhead(size_t n){
+    return n ? mallocChunkBytes(n) - n : 0;
+}
+
+template<typename T>
+void addVector(Footprint& footprint, const vector<T>& v){
+    footprint.bytes += v.capacity() * sizeof(T);
+    footprint.overhead += mallocOverhead(v.capacity() * sizeof(T));
+}
+
+// libstdc++ map and set nodes: color and three links, then the value
+template<typename Value>
+constexpr size_t treeNodeBytes(){
+    return 4 * sizeof(void*) + sizeof(Value);
+}
+
+//
+// graphFootprints
+//
+// The vertices of a graph<>, as map nodes, and its Edge nodes: the arena's
+// blocks, or one heap block per edge for an allocator that frees them singly.
+//
+template<typename VertexT, typename WeightT, template<typename> class EdgeAllocatorT>
+void graphFootprints(const graph<VertexT, WeightT, EdgeAllocatorT>& G, vector<Footprint>& footprints){
+
+    typedef graph<VertexT, WeightT, EdgeAllocatorT> Graph;
+
+    Footprint vertices{"graph vertices", static_cast<size_t>(G.NumVertices())};
+    size_t nodeBytes = treeNodeBytes<pair<const VertexT, void*>>();
+    vertices.bytes = vertices.count * nodeBytes;
+    vertices.overhead = vertices.count * mallocOverhead(nodeBytes);
+
+    Footprint edges{"graph edges", static_cast<size_t>(G.NumEdges())};
+    if (Graph::EdgesFreedIndividually){
+        edges.bytes = edges.count * Graph::EdgeBytes;
+        edges.overhead = edges.count * mallocOverhead(Graph::EdgeBytes);
+    }
+    else{
+        edges.bytes = G.edgeBytes();
+    }
+
+    footprints.push_back(vertices);
+    footprints.push_back(edges);
+}
+
+//
+// xmlFootprint
+//
+// The parsed document: the copy of the file tinyxml2 parses in place
+// (bufferBytes, the file's size) and the pooled nodes and attributes.
+//
+Footprint xmlFootprint(const XMLDocument& xmldoc, size_t bufferBytes);
+
+//
+// mapFootprints
+//
+// One Footprint per structure of a loaded map.
+//
+vector<Footprint> mapFootprints(const MapData& data);
+
+// a table for people, with a total line, and the same figures as one JSON array
+void printFootprints(ostream& out, const vector<Footprint>& footprints);
+void writeFootprintsJson(ostream& out, const vector<Footprint>& footprints);
+
+// the resident set size of this process in KiB, now, and at its peak
+long residentKiB();
+long peakResidentKiB();
+
+// hands memory that was freed but kept by malloc back to the system, where the
+// allocator allows it
+void releaseFreeMemory();
+
+//
+// PhaseMemory
+//
+// The resident set at the end of a phase, and its peak during the phase.
+//
+struct PhaseMemory
+{
+  string phase;
+  long residentKiB;
+  long peakKiB;
+};
+
+//
+// MemoryPhases
+//
+// Records the resident set phase by phase. The kernel's peak is reset at the
+// start of each phase, so each peak is the phase's own; where it cannot be
+// reset, each peak is the process's peak so far.
+//
+class MemoryPhases {
+    private:
+
+        vector<PhaseMemory> phases;
+        vector<Footprint> freed;
+        bool peakResets;
+
+        bool _ResetPeak();
+
+    public:
+
+        // the first phase starts here
+        MemoryPhases();
+
+        // ends the current phase, named phase, and starts the next
+        void mark(const string& phase);
+
+        // a structure the load freed, as it was just before
+        void noteFreed(const Footprint& footprint) { freed.push_back(footprint); }
+
+        const vector<PhaseMemory>& list() const { return phases; }
+        const vector<Footprint>& freedStructures() const { return freed; }
+        bool peaksArePerPhase() const { return peakResets; }
+
+        void print(ostream& out) const;
+        void writeJson(ostream& out) const;
+};
@@ -2,6 +2,10 @@
 // Jasoon Liang
 //
 // Basic graph class graph using adjaceny list representation.  
+//
+// Edge nodes come from an allocation policy (see arena.h). The default,
+// ArenaAllocator, keeps all edges in a few large blocks, so building a graph
+// does not call malloc per edge and destroying it frees only the blocks.
 
 #pragma once
 
@@ -11,9 +15,11 @@
 #include <set>
 #include <map>
 
+#include "arena.h"
+
 using namespace std;
 
-template<typename VertexT, typename WeightT>
+template<typename VertexT, typename WeightT, template<typename> class EdgeAllocatorT = ArenaAllocator>
 class graph {
     private:
     
@@ -27,6 +33,7 @@ class graph {
 
         map<VertexT, Edge*> adjList; //map storing the adjaceny list
         int totEdges = 0;
+        EdgeAllocatorT<Edge> edgeAllocator; //owns the Edge nodes
 
         //
         // _LookupVertex
@@ -36,88 +43,114 @@ class graph {
             return adjList.count(v);
         }
 
-
-    public:
-
         //
-        // default constructor:
+        // _Clear
+        // frees every Edge node and removes all vertices
         //
-        graph() {}
+        void _Clear() {
+            if constexpr (EdgeAllocatorT<Edge>::FreesIndividually){
+                for (auto& pair : this->adjList){
 
-        //copy constructor:
-        //creates a deep copy of an existing graph
-        graph(const graph& other){
+                    Edge* currEdge = pair.second;
+                    Edge* temp;
 
-            this->~graph(); //destroys/clears the current graph
+                    while (currEdge){
+
+                        temp = currEdge;
+                        currEdge = currEdge->next;
 
-            //gets all the vertex from the other graph, and adds them to the current graph
-            vector<VertexT> vertices = other.getVertices();
-            for (VertexT vertex : vertices){
-                this->addVertex(vertex);
+                        this->edgeAllocator.deallocate(temp);
+                    }
+                }
             }
 
-            //finds all the neighbors of each vertex, and adds the edges to the graph
-            for (VertexT vertex : vertices){
+            this->edgeAllocator.release();
+            this->adjList.clear();
+            this->totEdges = 0;
+        }
+
+        //
+        // _CopyFrom
+        // copies the vertices and edges of another graph into this empty graph,
+        // keeping each vertex's edges in the same order
+        //
+        void _CopyFrom(const graph& other) {
+            for (const auto& pair : other.adjList){
 
-                set<VertexT> neighbors = other.neighbors(vertex);
+                Edge*& head = this->adjList.emplace_hint(this->adjList.end(), pair.first, nullptr)->second;
+                Edge** tail = &head;
 
-                for (VertexT n : neighbors){
-                    WeightT weight;
-                    other.getWeight(vertex, n, weight);
+                for (Edge* currEdge = pair.second; currEdge; currEdge = currEdge->next){
+                    Edge* newEdge = this->edgeAllocator.allocate();
+                    newEdge->edgeWeight = currEdge->edgeWeight;
+                    newEdge->vertexId = currEdge->vertexId;
 
-                    this->addEdge(vertex, n, weight);
+                    *tail = newEdge;
+                    tail = &newEdge->next;
                 }
             }
+
+            this->totEdges = other.totEdges;
         }
 
-        //assignment operator:
-        //creates a deep copy of an existing graph
-        graph operator=(const graph& other){
 
-            this->~graph(); //destroys/clears the current graph
+    public:
 
-            //gets all the vertex from the other graph, and adds them to the current graph
-            vector<VertexT> vertices = other.getVertices();
-            for (VertexT vertex : vertices){
-                this->addVertex(vertex);
-            }
+        //
+        // default constructor:
+        //
+        graph() {}
 
-            //finds all the neighbors of each vertex, and adds the edges to the graph
-            for (VertexT vertex : vertices){
+        //copy constructor:
+        //creates a deep copy of an existing graph
+        graph(const graph& other){
+            this->_CopyFrom(other);
+        }
 
-                set<VertexT> neighbors = other.neighbors(vertex);
+        //move constructor:
+        //takes over the other graph's vertices and edges, leaving it empty
+        graph(graph&& other) noexcept
+            : adjList(std::move(other.adjList)), totEdges(other.totEdges),
+              edgeAllocator(std::move(other.edgeAllocator)) {
 
-                for (VertexT n : neighbors){
-                    WeightT weight;
-                    other.getWeight(vertex, n, weight);
+            other.adjList.clear();
+            other.totEdges = 0;
+        }
 
-                    this->addEdge(vertex, n, weight);
-                }
+        //assignment operator:
+        //creates a deep copy of an existing graph
+        graph& operator=(const graph& other){
+
+            if (this != &other){
+                this->_Clear(); //destroys/clears the current graph
+                this->_CopyFrom(other);
             }
 
             return *(this);
         }
 
-        // destructor:
-        // frees all allocated memory of each Edge node
-        ~graph(){
-            for (auto& pair : this->adjList){
+        //move assignment operator:
+        //frees the current graph and takes over the other graph's vertices and edges
+        graph& operator=(graph&& other) noexcept {
 
-                Edge* currEdge = pair.second;
-                Edge* temp;
+            if (this != &other){
+                this->_Clear();
 
-                while (currEdge){
-                    
-                    temp = currEdge;
-                    currEdge = currEdge->next;
+                this->adjList = std::move(other.adjList);
+                this->totEdges = other.totEdges;
+                this->edgeAllocator = std::move(other.edgeAllocator);
 
-                    delete temp;
-                }
+                other.adjList.clear();
+                other.totEdges = 0;
             }
 
-            this->adjList.clear();
-            this->totEdges = 0;
+            return *(this);
+        }
 
+        // destructor:
+        // frees all allocated memory of each Edge node
+        ~graph(){
+            this->_Clear();
         }
 
         //
@@ -175,45 +208,98 @@ class graph {
                 return false;
             }
 
-            // create a new edge
-            Edge* newEdge = new Edge();
+            Edge*& head = this->adjList.at(from);
+            Edge* last = nullptr;
+
+            // loop through the linked list to find the appropriate place to add the new edge
+            // and if the edge already exists, its weight is overridden
+            for (Edge* currEdge = head; currEdge; currEdge = currEdge->next){
+
+                if (currEdge->vertexId == to){
+                    currEdge->edgeWeight = weight;
+                    return true;
+                }
+
+                last = currEdge;
+            }
+
+            // create a new edge, only once it is known to be new
+            Edge* newEdge = this->edgeAllocator.allocate();
             newEdge->edgeWeight = weight;
             newEdge->vertexId = to;
 
             // case for adding an edge the first time
-            if (!this->adjList.at(from)){
-                this->adjList.at(from) = newEdge;
+            if (!last){
+                head = newEdge;
             }
             else{
+                last->next = newEdge;
+            }
 
-                Edge* currEdge = this->adjList.at(from);
+            this->totEdges++;
+            return true;
+        }
 
-                // loop through the linked list to find the appropriate place to add the new edge
-                // and if the edge already exists, its weight is overridden
-                while (currEdge->next){
-                    
-                    if (currEdge->vertexId == to){
-                        currEdge->edgeWeight = weight;
+        //
+        // removeEdge
+        //
+        // Removes the edge (from, to) and returns true. If the edge does
+        // not exist, false is returned.
+        //
+        bool removeEdge(VertexT from, VertexT to) {
 
-                        delete newEdge;
-                        return true;
-                    }
+            auto found = this->adjList.find(from);
+            if (found == this->adjList.end()) {
+                return false;
+            }
 
-                    currEdge = currEdge->next;
-                }
+            // walk the list keeping a pointer to the link that points at the current edge
+            for (Edge** link = &found->second; *link; link = &(*link)->next){
 
-                if (currEdge->vertexId == to){
-                    currEdge->edgeWeight = weight;
+                if ((*link)->vertexId == to){
+                    Edge* removed = *link;
+                    *link = removed->next;
 
-                    delete newEdge;
+                    this->edgeAllocator.deallocate(removed);
+                    this->totEdges--;
                     return true;
                 }
+            }
+
+            return false;
+        }
 
-                currEdge->next = newEdge;
+        //
+        // removeVertex
+        //
+        // Removes the vertex v, the edges leaving it, and the edges into
+        // it from its neighbors, and returns true. Edges into v are only
+        // looked for at the vertices v has an edge to, which finds all of
+        // them when every edge is stored in both directions. If the vertex
+        // does not exist, false is returned.
+        //
+        bool removeVertex(VertexT v) {
 
+            auto found = this->adjList.find(v);
+            if (found == this->adjList.end()) {
+                return false;
             }
 
-            this->totEdges++;
+            Edge* currEdge = found->second;
+
+            while (currEdge){
+                Edge* temp = currEdge;
+                currEdge = currEdge->next;
+
+                if (!(temp->vertexId == v)){
+                    this->removeEdge(temp->vertexId, v);
+                }
+
+                this->edgeAllocator.deallocate(temp);
+                this->totEdges--;
+            }
+
+            this->adjList.erase(found);
             return true;
         }
 
@@ -282,6 +368,19 @@ class graph {
             return S;
         }
 
+        //
+        // edgeBytes
+        //
+        // Returns the bytes held for Edge nodes, if the allocator tracks them.
+        //
+        size_t edgeBytes() const {
+            return this->edgeAllocator.bytes();
+        }
+
+        // the size of one Edge node, and whether the allocator frees them one by one
+        static constexpr size_t EdgeBytes = sizeof(Edge);
+        static constexpr bool EdgesFreedIndividually = EdgeAllocatorT<Edge>::FreesIndividually;
+
         //
         // getVertices
         //
@@ -0,0 +1,143 @@
+// isochrone.cpp
+//
+// The bounded search behind an isochrone, and the boundary drawn around it.
+
+#include <cmath>
+#include <algorithm>
+
+#include "isochrone.h"
+#include "query.h"
+
+using namespace std;
+
+// directions the boundary is drawn in, 5 degrees apart
+static const int BoundarySectors = 72;
+
+/*function finds the position of a search vertex
+Takes 4 parameters:
+    1. data: the loaded map
+    2. v: the dense index of the vertex
+    3, 4. lat, lon: changed to the vertex's position
+No returns*/
+static void positionOf(const MapData& data, int v, double& lat, double& lon){
+
+    int index = data.Nodes.indexOf(data.Search.vertexIds[v]);
+    lat = data.Nodes.latOf(index);
+    lon = data.Nodes.lonOf(index);
+}
+
+/*function draws the boundary of the reached area: in each direction from the access
+node, the farthest reached node or the farthest reachable point of an edge leaving
+the area
+Takes 4 parameters:
+    1. data: the loaded map
+    2. ws: the workspace holding the bounded search
+    3. settled: the vertices the search settled, the access node first
+    4. result: the result to add the boundary to
+No returns*/
+static void buildBoundary(const MapData& data, const SearchWorkspace& ws, const vector<int>& settled,
+                          IsochroneResult& result){
+
+    double lat0, lon0;
+    positionOf(data, settled.front(), lat0, lon0);
+    double cosLat0 = cos(lat0 * M_PI / 180);
+
+    // per sector, the squared distance and position of the farthest point, in a flat projection around the access node
+    vector<double> farthest(BoundarySectors, 0);
+    vector<pair<double, double>> points(BoundarySectors);
+
+    auto consider = [&](double lat, double lon){
+        double x = (lon - lon0) * cosLat0, y = lat - lat0;
+        double r2 = x * x + y * y;
+        if (r2 == 0) return;
+
+        int sector = min(BoundarySectors - 1, static_cast<int>((atan2(y, x) + M_PI) / (2 * M_PI) * BoundarySectors));
+        if (r2 > farthest[sector]){
+            farthest[sector] = r2;
+            points[sector] = pair(lat, lon);
+        }
+    };
+
+    for (int u : settled){
+
+        double latU, lonU;
+        positionOf(data, u, latU, lonU);
+        consider(latU, lonU);
+
+        // an edge to a vertex out of reach is walked as far as the distance allows
+        double left = result.maxDistance - ws.distanceTo(u);
+
+        for (int e = data.Search.offsets[u]; e < data.Search.offsets[u + 1]; e++){
+
+            int v = data.Search.targets[e];
+            if (ws.distanceTo(v) != INF || data.Search.weights[e] <= 0) continue;
+
+            double t = left / data.Search.weights[e];
+            double latV, lonV;
+            positionOf(data, v, latV, lonV);
+            consider(latU + t * (latV - latU), lonU + t * (lonV - lonU));
+        }
+    }
+
+    // sectors run from -180 degrees around to 180, so the ring turns counterclockwise
+    for (int s = 0; s < BoundarySectors; s++){
+        if (farthest[s] > 0) result.boundary.push_back(points[s]);
+    }
+
+    if (result.boundary.empty()){
+        result.boundary.push_back(pair(lat0, lon0));
+    }
+}
+
+/*function answers one isochrone query: what can be walked to from a building
+Takes 4 parameters:
+    1. data: the loaded map
+    2. buildingName: the name or abbreviation given
+    3. maxDistance: the farthest walk, in miles
+    4. ws: the search workspace owned by the calling thread
+Returns the result of the query*/
+IsochroneResult findIsochrone(const MapData& data, const string& buildingName, double maxDistance,
+                              SearchWorkspace& ws){
+
+    IsochroneResult result;
+    result.maxDistance = maxDistance;
+
+    // by abbreviation or name first, then by the closest name, as meeting queries do
+    int b = findBuilding(data.BuildingNames, buildingName);
+    if (b < 0) return result;
+
+    result.buildingFound = true;
+    result.building = data.Buildings[b];
+
+    int start = data.BuildingAccess[b];
+    if (start < 0) return result;
+
+    result.accessNode = data.Search.vertexIds[start];
+
+    vector<int> settled;
+    dijkstra(start, data.Search, ws, maxDistance, &settled);
+
+    for (int v : settled){
+        result.nodes.push_back(data.Search.vertexIds[v]);
+        result.nodeDistances.push_back(ws.distanceTo(v));
+    }
+
+    // a building is reached when its own access node is, so only the buildings of
+    // the settled vertices are looked at
+    vector<pair<double, int>> reached;
+    for (int v : settled){
+        for (int a = data.AccessOffsets[v]; a < data.AccessOffsets[v + 1]; a++){
+            reached.push_back(pair(ws.distanceTo(v), data.AccessBuildings[a]));
+        }
+    }
+
+    sort(reached.begin(), reached.end());
+    for (const auto& [distance, i] : reached){
+        result.buildings.push_back(i);
+        result.buildingDistances.push_back(distance);
+    }
+
+    buildBoundary(data, ws, settled, result);
+
+    return result;
+}
@@ -0,0 +1,46 @@
+// isochrone.h
+//
+// The isochrone query: everything within a walking distance of a building. One
+// search runs from the building's access node and stops at the distance, so its
+// cost grows with the area reached rather than with the map. Distances are in
+// miles, like every path distance.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "osm.h"
+#include "mapdata.h"
+#include "search.h"
+
+using namespace std;
+
+//
+// IsochroneResult
+//
+// The nodes and buildings reachable within maxDistance, nearest first, and a
+// boundary around them as a ring of (lat, lon) points, counterclockwise. The
+// boundary is star-shaped around the building's access node: in each direction it
+// reaches as far as the walk does, counting the reachable part of the edges that
+// leave the area, so it follows the area's larger concavities where a convex hull
+// would not.
+//
+struct IsochroneResult
+{
+  bool buildingFound = false;
+  BuildingInfo building;
+  long long accessNode = 0;
+  double maxDistance = 0;
+
+  vector<long long> nodes;
+  vector<double> nodeDistances;
+
+  vector<int> buildings; // indexes into MapData::Buildings
+  vector<double> buildingDistances;
+
+  vector<pair<double, double>> boundary;
+};
+
+IsochroneResult findIsochrone(const MapData& data, const string& buildingName, double maxDistance,
+                              SearchWorkspace& ws);
@@ -0,0 +1,220 @@
+// loadgen.cpp
+//
+// Load generator for the server mode (application.exe --serve). Opens several
+// connections to the server's socket, sends queries from a query file (one
+// "building<TAB>building" per line, the same format as --batch) and reports the
+// throughput and latency percentiles.
+//
+// Usage: loadgen.exe SOCKET QUERYFILE [--connections N] [--requests N]
+//                    [--pipeline N] [--command MEET|PATH]
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+//
+// ClientStats
+//
+// What one connection measured: the latency of every request in microseconds,
+// and how many replies reported an error.
+//
+struct ClientStats
+{
+  vector<double> latencies;
+  int errors = 0;
+  bool failed = false;
+};
+
+/*function connects to the server's socket
+Returns the socket, or -1 on failure*/
+static int connectTo(const string& socketPath){
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0){
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static bool sendAll(int fd, const string& s){
+    size_t sent = 0;
+
+    while (sent < s.size()){
+        ssize_t n = send(fd, s.data() + sent, s.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += n;
+    }
+
+    return true;
+}
+
+/*function run by each connection's thread: keeps up to pipeline requests in flight
+until numRequests replies have arrived
+No returns*/
+static void runClient(const string& socketPath, const vector<string>& requests, int firstRequest,
+                      int numRequests, int pipeline, ClientStats& stats){
+
+    int fd = connectTo(socketPath);
+    if (fd < 0){
+        stats.failed = true;
+        return;
+    }
+
+    deque<Clock::time_point> inFlight;
+    string inBuf;
+    char buf[65536];
+    int sent = 0, received = 0;
+
+    while (received < numRequests){
+
+        // top up the pipeline
+        string batch;
+        while (sent < numRequests && (int)inFlight.size() < pipeline){
+            batch += requests[(firstRequest + sent) % requests.size()];
+            inFlight.push_back(Clock::now());
+            sent++;
+        }
+
+        if (!batch.empty() && !sendAll(fd, batch)){
+            stats.failed = true;
+            break;
+        }
+
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0){
+            stats.failed = true;
+            break;
+        }
+        inBuf.append(buf, n);
+
+        // every complete line is the reply to the oldest request in flight
+        size_t start = 0, end;
+        while ((end = inBuf.find('\n', start)) != string::npos){
+
+            auto now = Clock::now();
+            stats.latencies.push_back(chrono::duration<double, micro>(now - inFlight.front()).count());
+            inFlight.pop_front();
+
+            if (inBuf.compare(start, 10, "{\"ok\":true") != 0){
+                stats.errors++;
+            }
+
+            received++;
+            start = end + 1;
+        }
+        inBuf.erase(0, start);
+    }
+
+    close(fd);
+}
+
+static double percentile(const vector<double>& sorted, double p){
+    if (sorted.empty()) return 0;
+
+    size_t i = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[min(i, sorted.size() - 1)];
+}
+
+int main(int argc, char* argv[]) {
+
+    if (argc < 3){
+        cout << "Usage: " << argv[0] << " SOCKET QUERYFILE [--connections N] [--requests N] [--pipeline N] [--command MEET|PATH]" << endl;
+        return 1;
+    }
+
+    string socketPath = argv[1];
+    string queryFilename = argv[2];
+    int numConnections = 4, numRequests = 1000, pipeline = 1;
+    string command = "MEET";
+
+    for (int i = 3; i + 1 < argc; i += 2){
+        string arg = argv[i];
+
+        if (arg == "--connections") numConnections = max(1, atoi(argv[i + 1]));
+        else if (arg == "--requests") numRequests = max(1, atoi(argv[i + 1]));
+        else if (arg == "--pipeline") pipeline = max(1, atoi(argv[i + 1]));
+        else if (arg == "--command") command = argv[i + 1];
+    }
+
+    ifstream queryFile(queryFilename);
+    if (!queryFile){
+        cout << "**Error: unable to open query file '" << queryFilename << "'." << endl;
+        return 1;
+    }
+
+    vector<string> requests;
+    string line;
+    while (getline(queryFile, line)){
+        if (line.find('\t') != string::npos){
+            requests.push_back(command + " " + line + "\n");
+        }
+    }
+
+    if (requests.empty()){
+        cout << "**Error: no queries in '" << queryFilename << "'." << endl;
+        return 1;
+    }
+
+    // splits the requests between the connections
+    vector<ClientStats> stats(numConnections);
+    vector<thread> clients;
+
+    auto start = Clock::now();
+
+    for (int c = 0; c < numConnections; c++){
+        int count = numRequests / numConnections + (c < numRequests % numConnections ? 1 : 0);
+        int first = c * (numRequests / numConnections);
+
+        clients.emplace_back(runClient, socketPath, cref(requests), first, count, pipeline, ref(stats[c]));
+    }
+
+    for (thread& client : clients){
+        client.join();
+    }
+
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+    vector<double> latencies;
+    int errors = 0, failedConnections = 0;
+    for (const ClientStats& s : stats){
+        latencies.insert(latencies.end(), s.latencies.begin(), s.latencies.end());
+        errors += s.errors;
+        failedConnections += s.failed;
+    }
+    sort(latencies.begin(), latencies.end());
+
+    cout << fixed << setprecision(1);
+    cout << "# of connections: " << numConnections << " (" << failedConnections << " failed)" << endl;
+    cout << "# of replies: " << latencies.size() << " (" << errors << " errors)" << endl;
+    cout << "Throughput: " << latencies.size() / seconds << " queries/s" << endl;
+    cout << "Latency (us): p50 " << percentile(latencies, 50)
+         << ", p90 " << percentile(latencies, 90)
+         << ", p99 " << percentile(latencies, 99)
+         << ", max " << (latencies.empty() ? 0.0 : latencies.back()) << endl;
+
+    return failedConnections ? 1 : 0;
+}
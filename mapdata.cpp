@@ -0,0 +1,457 @@
+// mapdata.cpp
+//
+// Loads a map file into a MapData: reads the nodes, footways and buildings, then
+// builds the footway graph.
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <filesystem>
+
+#include "mapdata.h"
+#include "dist.h"
+#include "stats.h"
+#include "query.h"
+
+using namespace std;
+using namespace tinyxml2;
+
+/*function collects the footway nodes and building positions used by the nearest-node
+and destination searches
+Takes 1 parameter:
+    data: the map data, whose Nodes, Footways and Buildings are already read
+No returns*/
+static void buildPointArrays(MapData& data){
+
+    data.FootwayNodeIds.clear();
+    data.FootwayVectors = UnitVectorArrays();
+    data.FootwayPlanar = Equirectangular::Arrays();
+    data.BuildingPoints.clear();
+
+    // a node shared by several footways is only a candidate once, at its first appearance
+    vector<bool> seen(data.Nodes.size(), false);
+
+    for (const FootwayInfo& footway : data.Footways){
+        for (long long node : footway.Nodes){
+
+            int index = data.Nodes.indexOf(node);
+            if (index < 0 || seen[index]) continue;
+            seen[index] = true;
+
+            data.FootwayNodeIds.push_back(node);
+
+            if (data.Model == DistanceModel::Equirectangular){
+                data.FootwayPlanar.push_back(data.Planar.prepare(data.Nodes.latOf(index), data.Nodes.lonOf(index)));
+            }
+            else{
+                data.FootwayVectors.push_back(data.Nodes.vectorOf(index));
+            }
+        }
+    }
+
+    data.BuildingPoints.reserve(data.Buildings.size());
+    for (const BuildingInfo& building : data.Buildings){
+        data.BuildingPoints.push_back(building.Coords.Lat, building.Coords.Lon);
+    }
+}
+
+/*function adds every footway's edges to the graph, weighted by a distance model
+Takes 3 parameters:
+    1. data: the map data, whose Nodes and Footways are already read
+    2. model: the distance model
+    3. pointOf: returns the model's point for a node index
+No returns*/
+template<typename Model, typename PointOf>
+static void addFootwayEdges(MapData& data, const Model& model, PointOf pointOf){
+
+    // loops through Footways, taking each footway and adding each pair of nodes as an edge to G
+    for (FootwayInfo& footway : data.Footways){
+
+        int nodeCount = footway.Nodes.size();
+
+        for (int i = 0; i < nodeCount - 1; i++){
+
+            long long node1 = footway.Nodes.at(i), node2 = footway.Nodes.at(i + 1);
+            double dist = model.distance(pointOf(data.Nodes.indexOf(node1)), pointOf(data.Nodes.indexOf(node2)));
+
+            if (!data.G.addEdge(node1, node2, dist)){
+                cout << "Unable to add path from " << node1 << " to " << node2 << "(" << dist << ")\n";
+            }
+
+            if (!data.G.addEdge(node2, node1, dist)){
+                cout << "Unable to add path from " << node2 << " to " << node1 << "(" << dist << ")\n";
+            }
+
+        }
+    }
+}
+
+/*function lists the buildings by their access vertex, so a search can find the
+buildings it reached from the vertices it settled
+Takes 1 parameter:
+    data: the map, with its BuildingAccess set
+No returns*/
+static void buildAccessIndex(MapData& data){
+
+    data.AccessOffsets.assign(data.Search.numVertices() + 1, 0);
+
+    for (int access : data.BuildingAccess){
+        if (access >= 0) data.AccessOffsets[access + 1]++;
+    }
+    for (int v = 0; v < data.Search.numVertices(); v++){
+        data.AccessOffsets[v + 1] += data.AccessOffsets[v];
+    }
+
+    data.AccessBuildings.assign(data.AccessOffsets.back(), -1);
+    vector<int> next(data.AccessOffsets.begin(), data.AccessOffsets.end() - 1);
+
+    for (int b = 0; b < (int)data.BuildingAccess.size(); b++){
+        int access = data.BuildingAccess[b];
+        if (access >= 0) data.AccessBuildings[next[access]++] = b;
+    }
+}
+
+/*function finds each building's nearest footway node once, as a Search vertex, for
+the queries that start from a building without a meeting point search
+Takes 1 parameter:
+    data: the map, with its point arrays and SearchGraph built
+No returns*/
+static void buildBuildingAccess(MapData& data){
+
+    data.BuildingAccess.assign(data.Buildings.size(), -1);
+
+    if (!data.FootwayNodeIds.empty()){
+        for (size_t b = 0; b < data.Buildings.size(); b++){
+            data.BuildingAccess[b] = data.Search.indexOf(findNearestNode(data, data.Buildings[b]));
+        }
+    }
+
+    buildAccessIndex(data);
+}
+
+/*function gives each Search edge the class of the footway it comes from, and works
+out its cost under every profile; where footways share an edge, the last one read wins
+Takes 1 parameter:
+    data: the map, with its SearchGraph built
+No returns*/
+static void buildEdgeCosts(MapData& data){
+
+    vector<int>& edgeClasses = data.Search.edgeClasses;
+    edgeClasses.assign(data.Search.numEdges(), WayFilter::NotWalked);
+
+    for (const FootwayInfo& footway : data.Footways){
+        for (size_t i = 0; i + 1 < footway.Nodes.size(); i++){
+
+            int u = data.Search.indexOf(footway.Nodes[i]);
+            int v = data.Search.indexOf(footway.Nodes[i + 1]);
+            if (u < 0 || v < 0) continue;
+
+            for (int e : {data.Search.edgeBetween(u, v), data.Search.edgeBetween(v, u)}){
+                if (e >= 0) edgeClasses[e] = footway.Class;
+            }
+        }
+    }
+
+    buildSearchCosts(data.Search, data.Ways);
+}
+
+/*function builds the footway graph from the nodes and footways
+Takes 1 parameter:
+    data: the map data, whose Nodes and Footways are already read
+No returns*/
+void buildGraph(MapData& data){
+
+    STAT_TIMER(Phase::BuildGraph);
+
+    // loops through Nodes and adds each node to G as a vertex
+    for (int i = 0; i < data.Nodes.size(); i++){
+        data.G.addVertex(data.Nodes.idOf(i));
+    }
+
+    auto unitVectorOf = [&data](int index){ return data.Nodes.vectorOf(index); };
+
+    switch (data.Model){
+        case DistanceModel::Haversine:
+            addFootwayEdges(data, Haversine(), unitVectorOf);
+            break;
+        case DistanceModel::Equirectangular:
+            addFootwayEdges(data, data.Planar, [&data](int index){
+                return data.Planar.prepare(data.Nodes.latOf(index), data.Nodes.lonOf(index));
+            });
+            break;
+        default:
+            addFootwayEdges(data, SphericalCosines(), unitVectorOf);
+            break;
+    }
+
+    buildSearchGraph(data.G, data.Search);
+    buildEdgeCosts(data);
+    buildBuildingAccess(data);
+}
+
+/*function computes the length of the edge between two nodes under the map's distance model
+Takes 3 parameters:
+    1. data: the map data
+    2 - 3. index1, index2: the nodes' indexes in data.Nodes
+Returns the distance in miles*/
+double edgeDistance(const MapData& data, int index1, int index2){
+
+    switch (data.Model){
+        case DistanceModel::Haversine:
+            return Haversine().distance(data.Nodes.vectorOf(index1), data.Nodes.vectorOf(index2));
+        case DistanceModel::Equirectangular:
+            return data.Planar.distance(data.Planar.prepare(data.Nodes.latOf(index1), data.Nodes.lonOf(index1)),
+                                        data.Planar.prepare(data.Nodes.latOf(index2), data.Nodes.lonOf(index2)));
+        default:
+            return SphericalCosines().distance(data.Nodes.vectorOf(index1), data.Nodes.vectorOf(index2));
+    }
+}
+
+/*function builds the building name index, ranking completions by each building's
+footprint area: the map has no visitor counts, and larger buildings (libraries,
+student centers, lecture halls) are the ones most people head to
+Takes 1 parameter:
+    data: the map data, with its buildings and their outlines read
+No returns*/
+static void buildBuildingNames(MapData& data){
+
+    vector<float> areas(data.Buildings.size(), 0.0f);
+
+    for (size_t b = 0; b < data.BuildingOutlines.size() && b < areas.size(); b++){
+
+        const vector<long long>& outline = data.BuildingOutlines[b];
+        double area = 0;
+
+        // shoelace formula, in degrees with longitude scaled by cos(latitude); the
+        // outline may or may not repeat its first node at the end
+        double scale = cos(data.Buildings[b].Coords.Lat * 3.14159265 / 180.0);
+        for (size_t i = 0; i < outline.size(); i++){
+            int p = data.Nodes.indexOf(outline[i]), q = data.Nodes.indexOf(outline[(i + 1) % outline.size()]);
+            if (p < 0 || q < 0) continue;
+
+            area += data.Nodes.lonOf(p) * scale * data.Nodes.latOf(q) - data.Nodes.lonOf(q) * scale * data.Nodes.latOf(p);
+        }
+
+        areas[b] = static_cast<float>(fabs(area) / 2);
+    }
+
+    data.BuildingNames.build(data.Buildings, areas);
+}
+
+/*function finds which of some footway nodes is nearest a building, under the map's
+distance model
+Takes 3 parameters:
+    1. data: the map data
+    2. building: the building
+    3. ids: the candidate node IDs; the first wins ties
+Returns the ID of the nearest*/
+static long long nearestAmong(const MapData& data, const BuildingInfo& building, const vector<long long>& ids){
+
+    double lat = building.Coords.Lat, lon = building.Coords.Lon;
+    size_t closest;
+
+    if (data.Model == DistanceModel::Equirectangular){
+        Equirectangular::Arrays points;
+        for (long long id : ids){
+            int index = data.Nodes.indexOf(id);
+            points.push_back(data.Planar.prepare(data.Nodes.latOf(index), data.Nodes.lonOf(index)));
+        }
+        closest = data.Planar.nearest(data.Planar.prepare(lat, lon), points);
+    }
+    else{
+        UnitVectorArrays points;
+        for (long long id : ids){
+            points.push_back(data.Nodes.vectorOf(data.Nodes.indexOf(id)));
+        }
+        SphericalCosines spherical;
+        closest = spherical.nearest(spherical.prepare(lat, lon), points);
+    }
+
+    return ids[closest];
+}
+
+/*function builds the search arrays and name index a freshly read map needs before its graph
+Takes 1 parameter:
+    data: the map data, whose nodes, footways and buildings are read and Model set
+No returns*/
+void buildIndexes(MapData& data){
+
+    STAT_TIMER(Phase::BuildIndexes);
+
+    buildPointArrays(data);
+    buildBuildingNames(data);
+}
+
+/*function updates each building's access vertex after an edit. A building that did not
+change, and whose access node was not touched, keeps it unless a touched footway node
+is now nearer: every node it was nearer than before is still where it was. Other
+buildings search every footway node again
+Takes 2 parameters:
+    1. data: the edited map, with its point arrays and SearchGraph updated
+    2. edit: what the edit touched
+No returns*/
+static void updateBuildingAccess(MapData& data, const MapEdit& edit){
+
+    data.BuildingAccess.assign(data.Buildings.size(), -1);
+    if (data.FootwayNodeIds.empty()){
+        buildAccessIndex(data);
+        return;
+    }
+
+    vector<long long> touchedFootwayNodes;
+    for (long long id : data.FootwayNodeIds){
+        if (edit.touchedNodes.count(id)) touchedFootwayNodes.push_back(id);
+    }
+
+    vector<long long> candidates;
+
+    for (size_t b = 0; b < data.Buildings.size(); b++){
+
+        const BuildingInfo& building = data.Buildings[b];
+        auto before = edit.accessBefore.find(building.Coords.ID);
+        long long access;
+
+        if (before == edit.accessBefore.end() || edit.changedBuildings.count(building.Coords.ID)
+            || edit.touchedNodes.count(before->second)){
+            access = findNearestNode(data, building);
+        }
+        else{
+            candidates.assign(1, before->second);
+            candidates.insert(candidates.end(), touchedFootwayNodes.begin(), touchedFootwayNodes.end());
+            access = nearestAmong(data, building, candidates);
+        }
+
+        data.BuildingAccess[b] = data.Search.indexOf(access);
+    }
+
+    buildAccessIndex(data);
+}
+
+/*function notes the access node of every building, before an edit changes the SearchGraph
+Takes 2 parameters:
+    1. data: the map data, not yet edited
+    2. edit: the edit to note them in
+No returns*/
+void noteAccessBefore(const MapData& data, MapEdit& edit){
+
+    for (size_t b = 0; b < data.Buildings.size() && b < data.BuildingAccess.size(); b++){
+        if (data.BuildingAccess[b] >= 0){
+            edit.accessBefore[data.Buildings[b].Coords.ID] = data.Search.vertexIds[data.BuildingAccess[b]];
+        }
+    }
+}
+
+/*function updates everything derived from the nodes, footways, buildings and G after an
+edit: the nearest-node and destination search arrays, the building name index if
+buildings changed, the touched rows of the SearchGraph and the buildings' access
+vertices. Precomputed trees are dropped, since their vertex indexes may no longer be
+valid
+Takes 2 parameters:
+    1. data: the map data, after its nodes, footways, buildings or graph changed
+    2. edit: what the edit touched
+No returns*/
+void updateIndexes(MapData& data, const MapEdit& edit){
+
+    STAT_TIMER(Phase::BuildIndexes);
+
+    buildPointArrays(data);
+    if (edit.buildingsChanged) buildBuildingNames(data);
+
+    auto classOf = [&edit](long long from, long long to, int previous){
+        auto found = edit.edgeClasses.find(pair(from, to));
+        return (found != edit.edgeClasses.end()) ? found->second : previous;
+    };
+    patchSearchGraph(data.G, edit.touchedNodes, classOf, data.Ways, data.Search);
+
+    updateBuildingAccess(data, edit);
+    data.Trees = BuildingTrees();
+}
+
+/*function parses a map file and reads its nodes, footways and buildings into a MapData
+the parsed document, usually the largest allocation of a load, only lives inside
+this function, so it is freed before anything else is built
+Takes 3 parameters:
+    1. filename: the map file to read
+    2. data: the MapData to fill
+    3. phases: if not null, the resident set is recorded after each phase, and the
+       document's size before it is freed
+Returns false if the file could not be loaded*/
+static bool readMapFile(const string& filename, MapData& data, MemoryPhases* phases){
+
+    XMLDocument xmldoc;
+
+    //
+    // Load XML-based map file
+    //
+    if (!LoadOpenStreetMap(filename, xmldoc)) {
+        return false;
+    }
+    if (phases) phases->mark("LoadOpenStreetMap");
+
+    //
+    // Read the nodes, which are the various known positions on the map:
+    //
+    int nodeCount = ReadMapNodes(xmldoc, data.Nodes);
+    if (phases) phases->mark("ReadMapNodes");
+
+    //
+    // Read the footways, which are the walking paths:
+    //
+    int footwayCount = ReadFootways(xmldoc, data.Footways, data.Ways);
+    if (phases) phases->mark("ReadFootways");
+
+    //
+    // Read the university buildings:
+    //
+    int buildingCount = ReadUniversityBuildings(xmldoc, data.Nodes, data.Buildings, &data.BuildingOutlines);
+    if (phases) phases->mark("ReadUniversityBuildings");
+
+    assert(nodeCount == (int)data.Nodes.size());
+    assert(footwayCount == (int)data.Footways.size());
+    assert(buildingCount == (int)data.Buildings.size());
+
+    if (phases){
+        error_code ec;
+        size_t fileBytes = filesystem::file_size(filename, ec);
+        phases->noteFreed(xmlFootprint(xmldoc, ec ? 0 : fileBytes));
+    }
+
+    return true;
+}
+
+/*function loads a map file
+Takes 5 parameters:
+    1. filename: the map file to load
+    2. data: the MapData to fill
+    3. model: the distance model for edge weights and nearest-node searches
+    4. maxRelError: for DistanceModel::Auto, the largest relative error allowed
+    5. phases: if not null, the resident set is recorded after each phase of the load
+Returns false if the file could not be loaded*/
+bool loadMapData(const string& filename, MapData& data,
+                 DistanceModel model, double maxRelError, MemoryPhases* phases){
+
+    if (!readMapFile(filename, data, phases)) {
+        return false;
+    }
+
+    // the document's pool blocks are small heap blocks, which free() keeps for reuse
+    releaseFreeMemory();
+    if (phases) phases->mark("free XMLDocument");
+
+    data.Model = model;
+
+    if (model == DistanceModel::Auto || model == DistanceModel::Equirectangular){
+        double worstRelError;
+        DistanceModel cheapest = chooseDistanceModel(data.Nodes, maxRelError, data.Planar, worstRelError);
+
+        if (model == DistanceModel::Auto) data.Model = cheapest;
+    }
+
+    buildIndexes(data);
+    if (phases) phases->mark("buildIndexes");
+
+    buildGraph(data);
+    if (phases) phases->mark("buildGraph");
+
+    return true;
+}
@@ -0,0 +1,127 @@
+// mapdata.h
+//
+// Everything loaded from a map file. Once loadMapData() returns, a MapData is
+// treated as immutable, which lets the query engine share it between threads.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "tinyxml2.h"
+#include "osm.h"
+#include "graph.h"
+#include "dist.h"
+#include "nodestore.h"
+#include "distmodel.h"
+#include "search.h"
+#include "spt.h"
+#include "buildingindex.h"
+#include "footprint.h"
+
+using namespace std;
+using namespace tinyxml2;
+
+struct MapData
+{
+  // every node's position (lat, lon) and unit vector, in ID order
+  NodeStore                    Nodes;
+  // the highway values read as footways, set before loading; each footway's
+  // Class is one of its classes
+  WayFilter                    Ways;
+  // info about each footway, in no particular order
+  vector<FootwayInfo>          Footways;
+  // info about each building, in no particular order
+  vector<BuildingInfo>         Buildings;
+  // the node IDs outlining each building, in the order of Buildings
+  vector<vector<long long>>    BuildingOutlines;
+  // abbreviation and name lookups over Buildings
+  BuildingIndex                BuildingNames;
+  // the distance model used for edge weights and nearest-node searches; Planar
+  // is only set up when Model is Equirectangular
+  DistanceModel                Model = DistanceModel::SphericalCosines;
+  Equirectangular              Planar;
+  // every node on a footway once, in the order first met walking Footways, and
+  // their positions for nearest-node searches under the model in use
+  vector<long long>            FootwayNodeIds;
+  UnitVectorArrays             FootwayVectors;
+  Equirectangular::Arrays      FootwayPlanar;
+  // the position of each building, in the order of Buildings
+  PointArrays                  BuildingPoints;
+  // the footway graph, and its adjacency arrays used for path finding
+  graph<long long, double>     G;
+  SearchGraph                  Search;
+  // the Search vertex of each building's nearest footway node, in the order of
+  // Buildings; -1 when the map has no footways
+  vector<int>                  BuildingAccess;
+  // the same, turned around: the buildings whose access vertex is v are
+  // AccessBuildings[AccessOffsets[v]] ... [AccessOffsets[v + 1] - 1]
+  vector<int>                  AccessOffsets;
+  vector<int>                  AccessBuildings;
+  // per-building shortest-path trees, only built when asked for
+  BuildingTrees                Trees;
+
+  MapData() {}
+  MapData(const MapData&) = delete;
+  MapData& operator=(const MapData&) = delete;
+};
+
+// loads a map file into data. Footways are the ways data.Ways accepts. The parsed
+// XML document is freed as soon as the nodes, footways and buildings are read,
+// before anything else is built. If phases is not null, the resident set is
+// recorded after each phase of the load.
+bool loadMapData(const string& filename, MapData& data,
+                 DistanceModel model = DistanceModel::SphericalCosines, double maxRelError = 1e-3,
+                 MemoryPhases* phases = nullptr);
+
+// builds the nearest-node and destination search arrays and the building name
+// index from the nodes, footways and buildings once they are read and data.Model
+// is set; loadMapData() calls this before buildGraph()
+void buildIndexes(MapData& data);
+
+// builds G, its SearchGraph with every profile's edge costs, and the buildings'
+// access vertices from the nodes, footways and buildings once they are read and
+// data.Model is set; loadMapData() calls this
+void buildGraph(MapData& data);
+
+// length of the edge between two nodes (by index in Nodes) under data.Model
+double edgeDistance(const MapData& data, int index1, int index2);
+
+// a hash for (node ID, node ID) edge keys
+struct EdgeKeyHash
+{
+  size_t operator()(const pair<long long, long long>& key) const {
+    return hash<long long>()(key.first) * 31 + hash<long long>()(key.second);
+  }
+};
+
+//
+// MapEdit
+//
+// What an edit of a loaded map touched, so updateIndexes() only redoes those
+// parts of the derived structures.
+//
+struct MapEdit
+{
+  // nodes created, moved or deleted, the ends of every edge added, removed or
+  // reweighted, and every node of a footway created, modified or deleted
+  unordered_set<long long> touchedNodes;
+  // the way class of each edge added, by (from, to) node IDs
+  unordered_map<pair<long long, long long>, int, EdgeKeyHash> edgeClasses;
+  // buildings created, modified or moved, by ID, and whether any changed at all
+  unordered_set<long long> changedBuildings;
+  bool buildingsChanged = false;
+  // each building's access node before the edit, by building ID
+  unordered_map<long long, long long> accessBefore;
+};
+
+// notes the access nodes of data's buildings in edit, before data is edited
+void noteAccessBefore(const MapData& data, MapEdit& edit);
+
+// updates the search arrays, building name index, SearchGraph, edge costs and
+// access vertices after the map was edited, redoing only what the edit touched:
+// the SearchGraph rows of touched vertices and the access of buildings near them.
+// The point arrays are rebuilt, and the precomputed trees dropped
+void updateIndexes(MapData& data, const MapEdit& edit);
@@ -0,0 +1,148 @@
+// nodestore.cpp
+//
+// Builds the flat node store: sorting, duplicate removal and the unit vector cache.
+
+#include <algorithm>
+#include <numeric>
+
+#include "nodestore.h"
+
+using namespace std;
+
+void NodeStore::add(long long id, double lat, double lon){
+
+    if (!ids.empty() && id <= ids.back()){
+        sorted = false;
+    }
+
+    ids.push_back(id);
+    lats.push_back(toStored(lat));
+    lons.push_back(toStored(lon));
+}
+
+void NodeStore::finish(){
+
+    // map files usually list nodes in ID order, so sorting is rarely needed
+    if (!sorted){
+
+        vector<int> order(ids.size());
+        iota(order.begin(), order.end(), 0);
+
+        // stable, so among equal IDs the last one added stays last
+        stable_sort(order.begin(), order.end(), [this](int a, int b){ return ids[a] < ids[b]; });
+
+        vector<long long> sortedIds;
+        vector<Degrees> sortedLats, sortedLons;
+        sortedIds.reserve(ids.size());
+        sortedLats.reserve(ids.size());
+        sortedLons.reserve(ids.size());
+
+        for (size_t i = 0; i < order.size(); i++){
+            int from = order[i];
+
+            // a repeated ID overwrites the one before it
+            if (!sortedIds.empty() && sortedIds.back() == ids[from]){
+                sortedLats.back() = lats[from];
+                sortedLons.back() = lons[from];
+                continue;
+            }
+
+            sortedIds.push_back(ids[from]);
+            sortedLats.push_back(lats[from]);
+            sortedLons.push_back(lons[from]);
+        }
+
+        ids.swap(sortedIds);
+        lats.swap(sortedLats);
+        lons.swap(sortedLons);
+        sorted = true;
+
+        // indexes have moved, so every vector is computed again
+        vectors = UnitVectorArrays();
+    }
+
+    ids.shrink_to_fit();
+    lats.shrink_to_fit();
+    lons.shrink_to_fit();
+
+    vectors.reserve(ids.size());
+
+    for (int i = static_cast<int>(vectors.size()); i < size(); i++){
+        vectors.push_back(toUnitVector(latOf(i), lonOf(i)));
+    }
+}
+
+void NodeStore::update(int index, double lat, double lon){
+
+    lats[index] = toStored(lat);
+    lons[index] = toStored(lon);
+
+    UnitVector v = toUnitVector(latOf(index), lonOf(index));
+    vectors.x[index] = v.x;
+    vectors.y[index] = v.y;
+    vectors.z[index] = v.z;
+}
+
+void NodeStore::erase(const vector<long long>& removed){
+
+    vector<bool> drop(ids.size(), false);
+    bool any = false;
+
+    for (long long id : removed){
+        int index = indexOf(id);
+        if (index >= 0){
+            drop[index] = true;
+            any = true;
+        }
+    }
+
+    if (!any) return;
+
+    // compacts every array in place, in one pass
+    size_t kept = 0;
+    for (size_t i = 0; i < ids.size(); i++){
+        if (drop[i]) continue;
+
+        ids[kept] = ids[i];
+        lats[kept] = lats[i];
+        lons[kept] = lons[i];
+        vectors.x[kept] = vectors.x[i];
+        vectors.y[kept] = vectors.y[i];
+        vectors.z[kept] = vectors.z[i];
+        kept++;
+    }
+
+    ids.resize(kept);
+    lats.resize(kept);
+    lons.resize(kept);
+    vectors.x.resize(kept);
+    vectors.y.resize(kept);
+    vectors.z.resize(kept);
+}
+
+void NodeStore::clear(){
+
+    ids.clear();
+    lats.clear();
+    lons.clear();
+    vectors = UnitVectorArrays();
+    sorted = true;
+}
+
+int NodeStore::indexOf(long long id) const {
+
+    auto it = lower_bound(ids.begin(), ids.end(), id);
+
+    if (it == ids.end() || *it != id){
+        return -1;
+    }
+
+    return static_cast<int>(it - ids.begin());
+}
+
+size_t NodeStore::bytes() const {
+
+    return ids.capacity() * sizeof(long long)
+         + (lats.capacity() + lons.capacity()) * sizeof(Degrees)
+         + (vectors.x.capacity() + vectors.y.capacity() + vectors.z.capacity()) * sizeof(double);
+}
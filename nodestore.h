@@ -0,0 +1,109 @@
+// nodestore.h
+//
+// Flat storage for every node in the map. Nodes are kept in ascending ID order
+// in parallel arrays (ID, latitude, longitude, unit vector), so a node is named
+// by its dense index here, which is also its vertex index in the SearchGraph,
+// and an ID is turned into an index by binary search.
+//
+// Coordinates are doubles by default. Building with -DFIXED_POINT_COORDINATES
+// stores them as 32-bit integers in units of 1e-7 degrees instead, the precision
+// OSM itself records them at, for 8 bytes of coordinates per node instead of 16.
+//
+// Each node's (lat, lon) is also converted to an (x, y, z) unit vector once, by
+// finish(), so every later distance between nodes is a dot product and one acos
+// instead of six trig calls. When a change moves a node or adds new ones,
+// update() and finish() refresh only their vectors.
+//
+// With the ID and the three vector components, a node takes 48 bytes (40 with
+// fixed-point coordinates), against roughly 80 for a std::map entry plus 24 for
+// the separate vector copy the map was paired with before.
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+#include "dist.h"
+
+using namespace std;
+
+class NodeStore {
+    private:
+
+#ifdef FIXED_POINT_COORDINATES
+        typedef int32_t Degrees;
+        static Degrees toStored(double degrees) { return static_cast<int32_t>(lround(degrees * 1e7)); }
+        static double fromStored(Degrees stored) { return stored * 1e-7; }
+#else
+        typedef double Degrees;
+        static Degrees toStored(double degrees) { return degrees; }
+        static double fromStored(Degrees stored) { return stored; }
+#endif
+
+        vector<long long> ids;    // sorted node IDs
+        vector<Degrees> lats;     // lats[i], lons[i] and vectors.x[i] ... belong to ids[i]
+        vector<Degrees> lons;
+        UnitVectorArrays vectors;
+        bool sorted = true;       // false while add() has appended IDs out of order
+
+    public:
+
+        //
+        // add
+        //
+        // Appends a node. Nodes may be added in any order, but the store cannot be
+        // searched until finish() has been called. If an ID is added twice, the
+        // last position wins.
+        //
+        void add(long long id, double lat, double lon);
+
+        //
+        // finish
+        //
+        // Sorts the nodes by ID, drops duplicate IDs, and caches the unit vectors.
+        // If the nodes added since the last finish() all have larger IDs than the
+        // ones before, only their vectors are computed.
+        //
+        void finish();
+
+        //
+        // update
+        //
+        // Moves the node at an index to a new position.
+        //
+        void update(int index, double lat, double lon);
+
+        //
+        // erase
+        //
+        // Removes the nodes with the given IDs; unknown IDs are ignored. Indexes
+        // of the nodes after the first removed one change.
+        //
+        void erase(const vector<long long>& removed);
+
+        void clear();
+
+        int size() const { return static_cast<int>(ids.size()); }
+        bool empty() const { return ids.empty(); }
+
+        // returns the index of a node ID, or -1 if it is unknown
+        int indexOf(long long id) const;
+        bool contains(long long id) const { return indexOf(id) >= 0; }
+
+        long long idOf(int index) const { return ids[index]; }
+        double latOf(int index) const { return fromStored(lats[index]); }
+        double lonOf(int index) const { return fromStored(lons[index]); }
+
+        UnitVector vectorOf(int index) const {
+            return UnitVector{vectors.x[index], vectors.y[index], vectors.z[index]};
+        }
+
+        // distance in miles between the nodes at two indexes
+        double distance(int index1, int index2) const {
+            return distBetweenVectors(vectorOf(index1), vectorOf(index2));
+        }
+
+        // bytes held by the arrays
+        size_t bytes() const;
+};
@@ -30,6 +30,8 @@
 
 #include "tinyxml2.h"
 #include "osm.h"
+#include "nodestore.h"
+#include "stats.h"
 
 using namespace std;
 using namespace tinyxml2;
@@ -40,6 +42,8 @@ using namespace tinyxml2;
 //
 bool LoadOpenStreetMap(string filename, XMLDocument& xmldoc)
 {
+  STAT_TIMER(Phase::LoadOpenStreetMap);
+
   //
   // load the XML document:
   //
@@ -74,8 +78,10 @@ bool LoadOpenStreetMap(string filename, XMLDocument& xmldoc)
 //
 // ReadMapNodes
 //
-int ReadMapNodes(XMLDocument& xmldoc, map<long long, Coordinates>& Nodes)
+int ReadMapNodes(XMLDocument& xmldoc, NodeStore& Nodes)
 {
+  STAT_TIMER(Phase::ReadMapNodes);
+
   XMLElement* osm = xmldoc.FirstChildElement("osm");
   assert(osm != nullptr);
 
@@ -103,9 +109,9 @@ int ReadMapNodes(XMLDocument& xmldoc, map<long long, Coordinates>& Nodes)
     nodeCount++;
 
     //
-    // store node in the map:
+    // store node in the node store:
     //
-    Nodes[id] = Coordinates(id, latitude, longitude);
+    Nodes.add(id, latitude, longitude);
 
     //
     // next node element in the XML doc:
@@ -113,6 +119,11 @@ int ReadMapNodes(XMLDocument& xmldoc, map<long long, Coordinates>& Nodes)
     node = node->NextSiblingElement("node");
   }
 
+  //
+  // sort the nodes by ID so they can be looked up:
+  //
+  Nodes.finish();
+
   //
   // done:
   //
@@ -123,13 +134,17 @@ int ReadMapNodes(XMLDocument& xmldoc, map<long long, Coordinates>& Nodes)
 //
 // ReadFootways
 //
-int ReadFootways(XMLDocument& xmldoc, vector<FootwayInfo>& Footways)
+int ReadFootways(XMLDocument& xmldoc, vector<FootwayInfo>& Footways,
+  const WayFilter& Filter)
 {
+  STAT_TIMER(Phase::ReadFootways);
+
   XMLElement* osm = xmldoc.FirstChildElement("osm");
   assert(osm != nullptr);
 
   //
-  // Parse the XML document way by way, looking for footways:
+  // Parse the XML document way by way, looking for the ways Filter
+  // accepts, all called footways here:
   //
   int footwayCount = 0;
 
@@ -144,9 +159,10 @@ int ReadFootways(XMLDocument& xmldoc, vector<FootwayInfo>& Footways)
 
     //
     // we have to loop through all the tag attributes and
-    // see if this is a footway:
+    // see if this is a footway; its highway value is looked
+    // up in the filter's table once:
     //
-    bool isFootway = false;
+    int wayClass = WayFilter::NotWalked;
 
     XMLElement* tag = way->FirstChildElement("tag");
     while (tag != nullptr)
@@ -159,10 +175,9 @@ int ReadFootways(XMLDocument& xmldoc, vector<FootwayInfo>& Footways)
         const char* k_value = attrk->Value();
         const char* v_value = attrv->Value();
 
-        if ((strcmp(k_value, "highway") == 0) && (strcmp(v_value, "footway") == 0))
+        if (strcmp(k_value, "highway") == 0)
         {
-          footwayCount++;
-          isFootway = true;
+          wayClass = Filter.classOf(v_value);
           break;
         }
       }
@@ -174,9 +189,10 @@ int ReadFootways(XMLDocument& xmldoc, vector<FootwayInfo>& Footways)
     // if this is a footway, collect the node ids and store another
     // footway object in the vector:
     //
-    if (isFootway)
+    if (wayClass != WayFilter::NotWalked)
     {
-      FootwayInfo footway(id);
+      footwayCount++;
+      FootwayInfo footway(id, wayClass);
 
       XMLElement* nd = way->FirstChildElement("nd");
 
@@ -210,9 +226,12 @@ int ReadFootways(XMLDocument& xmldoc, vector<FootwayInfo>& Footways)
 // ReadUniversityBuildings
 //
 int ReadUniversityBuildings(XMLDocument& xmldoc,
-  map<long long, Coordinates>& Nodes,
-  vector<BuildingInfo>& Buildings)
+  const NodeStore& Nodes,
+  vector<BuildingInfo>& Buildings,
+  vector<vector<long long>>* Outlines)
 {
+  STAT_TIMER(Phase::ReadUniversityBuildings);
+
   XMLElement* osm = xmldoc.FirstChildElement("osm");
   assert(osm != nullptr);
 
@@ -276,18 +295,29 @@ int ReadUniversityBuildings(XMLDocument& xmldoc,
       double totalLon = 0.0;
       int    numNodes = 0;
 
+      //
+      // if asked for, keep the outline so the position can be recomputed:
+      //
+      vector<long long> outline;
+
       while (nd != nullptr)
       {
         const XMLAttribute* ndref = nd->FindAttribute("ref");
         assert(ndref != nullptr);
 
         long long id = ndref->Int64Value();
-        assert(Nodes.find(id) != Nodes.end());
+        int index = Nodes.indexOf(id);
+        assert(index >= 0);
 
-        totalLat += Nodes[id].Lat;
-        totalLon += Nodes[id].Lon;
+        totalLat += Nodes.latOf(index);
+        totalLon += Nodes.lonOf(index);
         numNodes++;
 
+        if (Outlines != nullptr)
+        {
+          outline.push_back(id);
+        }
+
         // advance to next node ref:
         nd = nd->NextSiblingElement("nd");
       }//while
@@ -315,6 +345,11 @@ int ReadUniversityBuildings(XMLDocument& xmldoc,
       }
 
       Buildings.push_back(BuildingInfo(fullname, abbrev, id, lat, lon));
+
+      if (Outlines != nullptr)
+      {
+        Outlines->push_back(outline);
+      }
     }//if
 
     way = way->NextSiblingElement("way");
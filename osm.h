@@ -18,10 +18,13 @@
 #include <map>
 
 #include "tinyxml2.h"
+#include "waytags.h"
 
 using namespace std;
 using namespace tinyxml2;
 
+class NodeStore;
+
 
 //
 // Coordinates:
@@ -61,19 +64,25 @@ struct Coordinates
 // nx, ny.  n1 and ny denote the endpoints of the sidewalk, and the points
 // n2, ..., nx are intermediate points along the sidewalk.
 //
+// Class is the way's class in the WayFilter it was read with (footway,
+// steps, ...), which gives its speed factor.
+//
 struct FootwayInfo
 {
   long long ID;
+  int Class;
   vector<long long> Nodes;
 
   FootwayInfo()
   {
     ID = 0;
+    Class = 0;
   }
 
-  FootwayInfo(long long id)
+  FootwayInfo(long long id, int wayClass = 0)
   {
     ID = id;
+    Class = wayClass;
   }
 };
 
@@ -110,8 +119,10 @@ struct BuildingInfo
 // Functions:
 //
 bool LoadOpenStreetMap(string filename, XMLDocument& xmldoc);
-int  ReadMapNodes(XMLDocument& xmldoc, map<long long, Coordinates>& Nodes);
-int  ReadFootways(XMLDocument& xmldoc, vector<FootwayInfo>& Footways);
+int  ReadMapNodes(XMLDocument& xmldoc, NodeStore& Nodes);
+int  ReadFootways(XMLDocument& xmldoc, vector<FootwayInfo>& Footways,
+       const WayFilter& Filter = WayFilter());
 int  ReadUniversityBuildings(XMLDocument& xmldoc,
-       map<long long, Coordinates>& Nodes,
-       vector<BuildingInfo>& Buildings);
+       const NodeStore& Nodes,
+       vector<BuildingInfo>& Buildings,
+       vector<vector<long long>>* Outlines = nullptr);
@@ -0,0 +1,498 @@
+// osmchange.cpp
+//
+// Reads osmChange documents and applies them to a MapData.
+
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+
+#include "osmchange.h"
+
+using namespace std;
+using namespace tinyxml2;
+
+//
+// WayChange
+//
+// A way from a change document, with the tags that matter here.
+//
+struct WayChange
+{
+  long long id = 0;
+  bool isFootway = false;
+  int wayClass = WayFilter::NotWalked;  // in the map's WayFilter, for footways
+  bool isBuilding = false;   // a university building with a name
+  string name;
+  vector<long long> nodes;
+};
+
+/*function reads a way element the way ReadFootways() and ReadUniversityBuildings() do
+Takes 3 parameters:
+    1. way: the way element
+    2. filter: the highway values walked, as the map was read with
+    3. change: filled with the way's ID, kind and node references
+No returns*/
+static void readWay(XMLElement* way, const WayFilter& filter, WayChange& change){
+
+    change.id = way->Int64Attribute("id");
+
+    bool university = false;
+    const char* name = nullptr;
+
+    for (XMLElement* tag = way->FirstChildElement("tag"); tag != nullptr; tag = tag->NextSiblingElement("tag")){
+
+        const char* k = tag->Attribute("k");
+        const char* v = tag->Attribute("v");
+        if (k == nullptr || v == nullptr) continue;
+
+        if (strcmp(k, "highway") == 0){
+            change.wayClass = filter.classOf(v);
+            change.isFootway = (change.wayClass != WayFilter::NotWalked);
+        }
+        if (strcmp(k, "building") == 0 && strcmp(v, "university") == 0) university = true;
+        if (strcmp(k, "name") == 0) name = v;
+    }
+
+    if (university && name != nullptr){
+        change.isBuilding = true;
+        change.name = name;
+    }
+
+    for (XMLElement* nd = way->FirstChildElement("nd"); nd != nullptr; nd = nd->NextSiblingElement("nd")){
+        change.nodes.push_back(nd->Int64Attribute("ref"));
+    }
+}
+
+//
+// ChangeApplier
+//
+// Applies one change document. The lookup tables it needs (footway and building
+// positions, which buildings use a node, how many footways share an edge) are
+// built the first time they are needed, so a change that only moves nodes never
+// walks the footways.
+//
+class ChangeApplier {
+    private:
+
+        MapData& data;
+        OsmChangeStats& stats;
+        MapEdit& edit;
+
+        unordered_map<long long, int> footwayPos;  // footway ID -> position in Footways
+        unordered_map<long long, int> buildingPos; // building ID -> position in Buildings
+        unordered_set<int> deletedFootways;        // positions, removed at the end
+        unordered_set<int> deletedBuildings;
+
+        bool haveBuildingsOfNode = false;
+        unordered_map<long long, vector<long long>> buildingsOfNode; // node ID -> building IDs
+        unordered_set<long long> movedBuildings;   // building IDs whose position must be recomputed
+
+        bool haveEdgeUses = false;
+        unordered_map<pair<long long, long long>, int, EdgeKeyHash> edgeUses; // footways using each edge
+
+        vector<long long> createdNodes; // added to Nodes, but not yet findable
+        vector<long long> deletedNodes; // removed from G, removed from Nodes at the end
+        unordered_set<long long> deletedNodeSet;
+
+        static pair<long long, long long> edgeKey(long long a, long long b) { return pair(min(a, b), max(a, b)); }
+
+        /*function makes created nodes findable and adds them to G*/
+        void flushNodes(){
+
+            if (createdNodes.empty()) return;
+
+            data.Nodes.finish();
+            for (long long id : createdNodes){
+                data.G.addVertex(id);
+                edit.touchedNodes.insert(id);
+            }
+            createdNodes.clear();
+        }
+
+        void indexBuildingsOfNode(){
+
+            if (haveBuildingsOfNode) return;
+
+            for (size_t b = 0; b < data.Buildings.size(); b++){
+                for (long long node : data.BuildingOutlines[b]){
+                    buildingsOfNode[node].push_back(data.Buildings[b].Coords.ID);
+                }
+            }
+            haveBuildingsOfNode = true;
+        }
+
+        void indexEdgeUses(){
+
+            if (haveEdgeUses) return;
+
+            for (size_t f = 0; f < data.Footways.size(); f++){
+                if (deletedFootways.count(f)) continue;
+
+                const vector<long long>& nodes = data.Footways[f].Nodes;
+                for (size_t i = 0; i + 1 < nodes.size(); i++){
+                    edgeUses[edgeKey(nodes[i], nodes[i + 1])]++;
+                }
+            }
+            haveEdgeUses = true;
+        }
+
+        /*function adds a footway's edges to G, weighted as buildGraph() does*/
+        void addFootwayEdges(const vector<long long>& nodes, int wayClass){
+
+            int before = data.G.NumEdges();
+
+            for (size_t i = 0; i + 1 < nodes.size(); i++){
+
+                long long node1 = nodes[i], node2 = nodes[i + 1];
+                int index1 = data.Nodes.indexOf(node1), index2 = data.Nodes.indexOf(node2);
+
+                if (haveEdgeUses) edgeUses[edgeKey(node1, node2)]++;
+
+                if (index1 < 0 || index2 < 0 || deletedNodeSet.count(node1) || deletedNodeSet.count(node2)){
+                    stats.skipped++;
+                    continue;
+                }
+
+                double dist = edgeDistance(data, index1, index2);
+                data.G.addEdge(node1, node2, dist);
+                data.G.addEdge(node2, node1, dist);
+
+                edit.touchedNodes.insert(node1);
+                edit.touchedNodes.insert(node2);
+                edit.edgeClasses[pair(node1, node2)] = wayClass;
+                edit.edgeClasses[pair(node2, node1)] = wayClass;
+            }
+
+            stats.edgesAdded += data.G.NumEdges() - before;
+        }
+
+        /*function removes a footway's edges from G, except those another footway still uses*/
+        void removeFootwayEdges(const vector<long long>& nodes){
+
+            indexEdgeUses();
+            int before = data.G.NumEdges();
+
+            for (size_t i = 0; i + 1 < nodes.size(); i++){
+
+                long long node1 = nodes[i], node2 = nodes[i + 1];
+                auto uses = edgeUses.find(edgeKey(node1, node2));
+
+                // a node may leave the footways even where the edge stays
+                edit.touchedNodes.insert(node1);
+                edit.touchedNodes.insert(node2);
+
+                if (uses != edgeUses.end() && --uses->second > 0) continue;
+                if (uses != edgeUses.end()) edgeUses.erase(uses);
+
+                data.G.removeEdge(node1, node2);
+                data.G.removeEdge(node2, node1);
+            }
+
+            stats.edgesRemoved += before - data.G.NumEdges();
+        }
+
+        /*function computes a building's position as ReadUniversityBuildings() does: the
+        average of its outline's nodes. Returns false if a node is unknown*/
+        bool buildingPosition(const vector<long long>& outline, double& lat, double& lon){
+
+            double totalLat = 0.0, totalLon = 0.0;
+
+            for (long long node : outline){
+                int index = data.Nodes.indexOf(node);
+                if (index < 0) return false;
+
+                totalLat += data.Nodes.latOf(index);
+                totalLon += data.Nodes.lonOf(index);
+            }
+
+            lat = totalLat / outline.size();
+            lon = totalLon / outline.size();
+            return !outline.empty();
+        }
+
+        /*function creates or replaces a building from a way*/
+        void putBuilding(const WayChange& way, bool existed){
+
+            double lat, lon;
+            if (!buildingPosition(way.nodes, lat, lon)){
+                stats.skipped++;
+                return;
+            }
+
+            // an abbreviation appears as "... (SEO)" in the name
+            string abbrev = "?";
+            size_t left = way.name.find('('), right = way.name.find(')');
+            if (left != string::npos && right != string::npos && left < right){
+                abbrev = way.name.substr(left + 1, right - left - 1);
+            }
+
+            BuildingInfo building(way.name, abbrev, way.id, lat, lon);
+            edit.changedBuildings.insert(way.id);
+            edit.buildingsChanged = true;
+
+            auto found = buildingPos.find(way.id);
+            if (found != buildingPos.end()){
+                data.Buildings[found->second] = building;
+                data.BuildingOutlines[found->second] = way.nodes;
+            }
+            else{
+                buildingPos[way.id] = static_cast<int>(data.Buildings.size());
+                data.Buildings.push_back(building);
+                data.BuildingOutlines.push_back(way.nodes);
+            }
+
+            if (haveBuildingsOfNode){
+                for (long long node : way.nodes){
+                    buildingsOfNode[node].push_back(way.id);
+                }
+            }
+
+            (existed ? stats.buildingsModified : stats.buildingsCreated)++;
+        }
+
+    public:
+
+        ChangeApplier(MapData& data, OsmChangeStats& stats, MapEdit& edit) : data(data), stats(stats), edit(edit) {
+
+            for (size_t f = 0; f < data.Footways.size(); f++){
+                footwayPos[data.Footways[f].ID] = static_cast<int>(f);
+            }
+            for (size_t b = 0; b < data.Buildings.size(); b++){
+                buildingPos[data.Buildings[b].Coords.ID] = static_cast<int>(b);
+            }
+        }
+
+        void putNode(long long id, double lat, double lon){
+
+            int index = data.Nodes.indexOf(id);
+
+            if (index < 0){
+                // consecutive new nodes are sorted in together, by flushNodes()
+                data.Nodes.add(id, lat, lon);
+                createdNodes.push_back(id);
+                stats.nodesCreated++;
+                return;
+            }
+
+            flushNodes();
+            index = data.Nodes.indexOf(id);
+            data.Nodes.update(index, lat, lon);
+
+            // deleted earlier in the same change, and now back
+            if (deletedNodeSet.erase(id)){
+                deletedNodes.erase(find(deletedNodes.begin(), deletedNodes.end(), id));
+                data.G.addVertex(id);
+            }
+            stats.nodesModified++;
+            edit.touchedNodes.insert(id);
+
+            // the node's edges change length
+            for (long long neighbor : data.G.neighbors(id)){
+                edit.touchedNodes.insert(neighbor);
+                double dist = edgeDistance(data, index, data.Nodes.indexOf(neighbor));
+                data.G.addEdge(id, neighbor, dist);
+                data.G.addEdge(neighbor, id, dist);
+                stats.edgesReweighted += 2;
+            }
+
+            // and buildings outlined by it move
+            indexBuildingsOfNode();
+            auto found = buildingsOfNode.find(id);
+            if (found != buildingsOfNode.end()){
+                movedBuildings.insert(found->second.begin(), found->second.end());
+            }
+        }
+
+        void deleteNode(long long id){
+
+            flushNodes();
+
+            edit.touchedNodes.insert(id);
+            for (long long neighbor : data.G.neighbors(id)){
+                edit.touchedNodes.insert(neighbor);
+            }
+
+            int before = data.G.NumEdges();
+            if (data.G.removeVertex(id)){
+                stats.edgesRemoved += before - data.G.NumEdges();
+                deletedNodes.push_back(id);
+                deletedNodeSet.insert(id);
+                stats.nodesDeleted++;
+            }
+        }
+
+        void putWay(const WayChange& way){
+
+            flushNodes();
+
+            // footway side
+            auto footway = footwayPos.find(way.id);
+            bool wasFootway = (footway != footwayPos.end());
+
+            if (wasFootway){
+                removeFootwayEdges(data.Footways[footway->second].Nodes);
+
+                if (way.isFootway){
+                    data.Footways[footway->second].Class = way.wayClass;
+                    data.Footways[footway->second].Nodes = way.nodes;
+                    addFootwayEdges(way.nodes, way.wayClass);
+                    stats.footwaysModified++;
+                }
+                else{
+                    deletedFootways.insert(footway->second);
+                    footwayPos.erase(footway);
+                    stats.footwaysDeleted++;
+                }
+            }
+            else if (way.isFootway){
+                FootwayInfo info(way.id, way.wayClass);
+                info.Nodes = way.nodes;
+
+                footwayPos[way.id] = static_cast<int>(data.Footways.size());
+                data.Footways.push_back(info);
+                addFootwayEdges(way.nodes, way.wayClass);
+                stats.footwaysCreated++;
+            }
+
+            // building side
+            auto building = buildingPos.find(way.id);
+            bool wasBuilding = (building != buildingPos.end());
+
+            if (way.isBuilding){
+                putBuilding(way, wasBuilding);
+            }
+            else if (wasBuilding){
+                deletedBuildings.insert(building->second);
+                buildingPos.erase(building);
+                edit.buildingsChanged = true;
+                stats.buildingsDeleted++;
+            }
+        }
+
+        void deleteWay(long long id){
+
+            WayChange none;
+            none.id = id;
+            putWay(none);
+        }
+
+        /*function finishes the change: drops deleted nodes, footways and buildings, and moves
+        the buildings whose outline nodes moved*/
+        void finish(){
+
+            flushNodes();
+            data.Nodes.erase(deletedNodes);
+
+            if (!deletedFootways.empty()){
+                vector<FootwayInfo> kept;
+                for (size_t f = 0; f < data.Footways.size(); f++){
+                    if (!deletedFootways.count(f)) kept.push_back(std::move(data.Footways[f]));
+                }
+                data.Footways.swap(kept);
+            }
+
+            if (!deletedBuildings.empty()){
+                vector<BuildingInfo> kept;
+                vector<vector<long long>> keptOutlines;
+                for (size_t b = 0; b < data.Buildings.size(); b++){
+                    if (deletedBuildings.count(b)) continue;
+                    kept.push_back(std::move(data.Buildings[b]));
+                    keptOutlines.push_back(std::move(data.BuildingOutlines[b]));
+                }
+                data.Buildings.swap(kept);
+                data.BuildingOutlines.swap(keptOutlines);
+            }
+
+            for (size_t b = 0; b < data.Buildings.size(); b++){
+
+                BuildingInfo& building = data.Buildings[b];
+                if (!movedBuildings.count(building.Coords.ID)) continue;
+
+                double lat, lon;
+                if (buildingPosition(data.BuildingOutlines[b], lat, lon)){
+                    building.Coords.Lat = lat;
+                    building.Coords.Lon = lon;
+                    edit.changedBuildings.insert(building.Coords.ID);
+                    edit.buildingsChanged = true;
+                    stats.buildingsModified++;
+                }
+            }
+        }
+};
+
+bool applyOsmChange(const string& filename, MapData& data, OsmChangeStats& stats){
+
+    stats = OsmChangeStats();
+    auto start = chrono::steady_clock::now();
+
+    XMLDocument xmldoc;
+    if (xmldoc.LoadFile(filename.c_str()) != XML_SUCCESS){
+        cout << "**ERROR: unable to load change file '" << filename << "'." << endl;
+        return false;
+    }
+
+    XMLElement* root = xmldoc.FirstChildElement("osmChange");
+    if (root == nullptr){
+        cout << "**ERROR: '" << filename << "' is not an osmChange document." << endl;
+        return false;
+    }
+
+    auto parsed = chrono::steady_clock::now();
+
+    MapEdit edit;
+    noteAccessBefore(data, edit);
+
+    ChangeApplier applier(data, stats, edit);
+
+    // changes are applied in document order, as OSM defines them
+    for (XMLElement* block = root->FirstChildElement(); block != nullptr; block = block->NextSiblingElement()){
+
+        bool deleting = (strcmp(block->Name(), "delete") == 0);
+        if (!deleting && strcmp(block->Name(), "create") != 0 && strcmp(block->Name(), "modify") != 0) continue;
+
+        for (XMLElement* element = block->FirstChildElement(); element != nullptr; element = element->NextSiblingElement()){
+
+            if (strcmp(element->Name(), "node") == 0){
+                long long id = element->Int64Attribute("id");
+
+                if (deleting){
+                    applier.deleteNode(id);
+                }
+                else{
+                    applier.putNode(id, element->DoubleAttribute("lat"), element->DoubleAttribute("lon"));
+                }
+            }
+            else if (strcmp(element->Name(), "way") == 0){
+
+                if (deleting){
+                    applier.deleteWay(element->Int64Attribute("id"));
+                }
+                else{
+                    WayChange way;
+                    readWay(element, data.Ways, way);
+                    applier.putWay(way);
+                }
+            }
+            else{
+                stats.skipped++;
+            }
+        }
+    }
+
+    applier.finish();
+
+    auto applied = chrono::steady_clock::now();
+
+    updateIndexes(data, edit);
+
+    auto rebuilt = chrono::steady_clock::now();
+
+    stats.parseMs = chrono::duration<double, milli>(parsed - start).count();
+    stats.applyMs = chrono::duration<double, milli>(applied - parsed).count();
+    stats.rebuildMs = chrono::duration<double, milli>(rebuilt - applied).count();
+
+    return true;
+}
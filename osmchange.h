@@ -0,0 +1,60 @@
+// osmchange.h
+//
+// Applies osmChange (.osc) documents, the format OSM publishes map updates in,
+// to a loaded MapData. Nodes, footways and buildings are created, modified and
+// deleted in place, and only the graph edges of the footways and nodes involved
+// are added, removed or reweighted. Of the structures derived from the map, only
+// the SearchGraph rows of the touched nodes and the access nodes of the buildings
+// near them are redone (updateIndexes()); the nearest-node search arrays are
+// rebuilt in one linear pass, which is still far cheaper than parsing the whole
+// map again.
+//
+// Edges removed from the graph are not reclaimed: its ArenaAllocator frees its
+// blocks only when the graph is destroyed, so each change file applied to a
+// loaded map adds to its memory until the map is reloaded.
+//
+// Relations are ignored, as they are when loading a map.
+
+#pragma once
+
+#include <string>
+
+#include "mapdata.h"
+
+using namespace std;
+
+//
+// OsmChangeStats
+//
+// What a change did, and how long each step took.
+//
+struct OsmChangeStats
+{
+  int nodesCreated = 0;
+  int nodesModified = 0;
+  int nodesDeleted = 0;
+  int footwaysCreated = 0;
+  int footwaysModified = 0;
+  int footwaysDeleted = 0;
+  int buildingsCreated = 0;
+  int buildingsModified = 0;
+  int buildingsDeleted = 0;
+  int edgesAdded = 0;
+  int edgesRemoved = 0;
+  int edgesReweighted = 0;
+  int skipped = 0;  // references to unknown nodes, and relations
+
+  double parseMs = 0;
+  double applyMs = 0;
+  double rebuildMs = 0;
+};
+
+//
+// applyOsmChange
+//
+// Applies the osmChange document in filename to data, which must not be shared
+// with running queries. Precomputed trees are dropped; rebuild them afterwards
+// if they are wanted. Returns false, leaving data unchanged, if the file cannot
+// be read or is not an osmChange document.
+//
+bool applyOsmChange(const string& filename, MapData& data, OsmChangeStats& stats);
@@ -0,0 +1,383 @@
+// osmgen.cpp
+//
+// Generator of synthetic OpenStreetMap files, for testing the loader and the
+// searches on maps far larger than uic.osm. The output is OSM XML with the parts
+// application.exe reads: nodes, footways (ways tagged highway=footway) and
+// university buildings (closed ways tagged building=university, named
+// "... (ABBR)").
+//
+// Usage: osmgen.exe [--nodes N] [--pattern grid|geometric] [--components C]
+//                   [--density F] [--buildings B] [--seed S] [-o FILE]
+//
+//    grid        nodes on a square lattice, footways along its rows and columns
+//    geometric   nodes scattered at random, footways between nodes closer than
+//                a fixed radius (about 6 candidates per node)
+//
+// --density is the fraction of candidate links (lattice neighbors, or nodes
+// within the radius) that become footways; --components splits the nodes into
+// C separate pieces with no footway between them. The same options and seed
+// always give the same file: every random choice comes from a hash of the seed
+// and what is being placed, so nothing needs to be kept in memory and maps of
+// 10^8 nodes stream straight to the file.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+// the lattice spacing, or the geometric pattern's cell size, in degrees of latitude
+static const double Spacing = 0.0004;
+static const double BaseLat = 41.87, BaseLon = -87.65;
+// nodes per cell of the geometric pattern, and the footway radius in cells
+static const int PointsPerCell = 4;
+static const double LinkRadius = 0.7;
+
+//
+// Options
+//
+struct Options
+{
+  long long nodes = 10000;
+  string pattern = "grid";
+  int components = 1;
+  double density = 0.8;
+  long long buildings = 100;
+  unsigned long long seed = 1;
+  string output;
+};
+
+/*function mixes its arguments into a well spread 64-bit value (splitmix64), so each
+random choice depends only on the seed and what it is for*/
+static uint64_t mix(uint64_t a, uint64_t b = 0, uint64_t c = 0, uint64_t d = 0){
+
+    uint64_t x = a;
+    for (uint64_t v : {b, c, d}){
+        x += 0x9e3779b97f4a7c15ull + v;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        x ^= x >> 31;
+    }
+    return x;
+}
+
+// a number in [0, 1) from a hash
+static double unit(uint64_t h){
+    return (h >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//
+// Block
+//
+// One component: count nodes with consecutive IDs from firstId, laid out in a
+// square area whose corner is (lat0, lon0).
+//
+struct Block
+{
+  int index;
+  long long firstId;
+  long long count;
+  long long side;  // lattice columns, or cells per row
+  double lat0, lon0;
+};
+
+//
+// Generator
+//
+// Writes one map. Positions are computed from node IDs on demand, for the nodes,
+// the footways and the buildings alike.
+//
+class Generator {
+    private:
+
+        Options options;
+        FILE* out;
+        vector<Block> blocks;
+        double lonSpacing;     // Spacing in degrees of longitude, so cells are square
+        long long nextWayId = 1;
+
+        bool grid() const { return options.pattern == "grid"; }
+
+        long long cellsOf(const Block& block) const { return (block.count + PointsPerCell - 1) / PointsPerCell; }
+
+        // the position of the i-th node of a block
+        void position(const Block& block, long long i, double& lat, double& lon) const {
+
+            if (grid()){
+                lat = block.lat0 + (i / block.side) * Spacing;
+                lon = block.lon0 + (i % block.side) * lonSpacing;
+                return;
+            }
+
+            long long cell = i / PointsPerCell;
+            uint64_t h = mix(options.seed, block.index, i);
+            lat = block.lat0 + (cell / block.side + unit(mix(h, 1))) * Spacing;
+            lon = block.lon0 + (cell % block.side + unit(mix(h, 2))) * lonSpacing;
+        }
+
+        void writeNode(long long id, double lat, double lon){
+            fprintf(out, " <node id=\"%lld\" lat=\"%.7f\" lon=\"%.7f\"/>\n", id, lat, lon);
+        }
+
+        void writeFootway(const vector<long long>& nodes){
+            fprintf(out, " <way id=\"%lld\">", nextWayId++);
+            for (long long id : nodes){
+                fprintf(out, "<nd ref=\"%lld\"/>", id);
+            }
+            fprintf(out, "<tag k=\"highway\" v=\"footway\"/></way>\n");
+        }
+
+        // whether the candidate link between two nodes becomes a footway
+        bool linked(long long id1, long long id2) const {
+            return unit(mix(options.seed, 3, id1, id2)) < options.density;
+        }
+
+        void gridFootways(const Block& block);
+        void geometricFootways(const Block& block);
+
+    public:
+
+        Generator(const Options& options, FILE* out);
+
+        void write();
+};
+
+Generator::Generator(const Options& options, FILE* out) : options(options), out(out) {
+
+    lonSpacing = Spacing / cos(BaseLat * M_PI / 180.0);
+
+    // components side by side from west to east, a few spacings apart
+    long long firstId = 1;
+    double lon0 = BaseLon;
+
+    for (int c = 0; c < options.components; c++){
+
+        Block block;
+        block.index = c;
+        block.firstId = firstId;
+        block.count = options.nodes / options.components + (c < options.nodes % options.components ? 1 : 0);
+
+        long long units = grid() ? block.count : cellsOf(block);
+        block.side = max(1LL, (long long)ceil(sqrt((double)units)));
+        block.lat0 = BaseLat;
+        block.lon0 = lon0;
+
+        blocks.push_back(block);
+
+        firstId += block.count;
+        lon0 += (block.side + 5) * lonSpacing;
+    }
+}
+
+/*function writes a grid block's footways: along each row and column, every run of
+consecutive linked lattice neighbors becomes one footway*/
+void Generator::gridFootways(const Block& block){
+
+    long long rows = (block.count + block.side - 1) / block.side;
+    vector<long long> run;
+
+    auto walk = [&](long long first, long long step, long long length){
+        run.clear();
+
+        for (long long k = 0; k < length; k++){
+            long long i = first + k * step;
+            if (i >= block.count) break;
+
+            run.push_back(block.firstId + i);
+
+            bool last = (k + 1 == length || i + step >= block.count);
+            if (last || !linked(block.firstId + i, block.firstId + i + step)){
+                if (run.size() > 1) writeFootway(run);
+                run.clear();
+            }
+        }
+    };
+
+    for (long long r = 0; r < rows; r++){
+        walk(r * block.side, 1, block.side);
+    }
+    for (long long c = 0; c < block.side; c++){
+        walk(c, block.side, rows);
+    }
+}
+
+/*function writes a geometric block's footways: a two-node footway between each pair
+of nodes within LinkRadius cells of each other that is linked. Only the 3 x 3 cells
+around a node can hold nodes that close, and their positions are recomputed rather
+than stored*/
+void Generator::geometricFootways(const Block& block){
+
+    long long cells = cellsOf(block);
+    double radius = LinkRadius * Spacing;
+
+    for (long long cell = 0; cell < cells; cell++){
+
+        long long row = cell / block.side, col = cell % block.side;
+
+        for (long long i = cell * PointsPerCell; i < min(block.count, (cell + 1) * PointsPerCell); i++){
+
+            double lat1, lon1;
+            position(block, i, lat1, lon1);
+
+            for (long long dr = -1; dr <= 1; dr++){
+                for (long long dc = -1; dc <= 1; dc++){
+
+                    long long r = row + dr, c = col + dc;
+                    if (r < 0 || c < 0 || c >= block.side) continue;
+
+                    long long other = r * block.side + c;
+                    if (other >= cells) continue;
+
+                    for (long long j = other * PointsPerCell; j < min(block.count, (other + 1) * PointsPerCell); j++){
+
+                        // each pair once, from its lower ID
+                        if (j <= i) continue;
+
+                        double lat2, lon2;
+                        position(block, j, lat2, lon2);
+
+                        double dLat = lat2 - lat1, dLon = (lon2 - lon1) * (Spacing / lonSpacing);
+                        if (dLat * dLat + dLon * dLon > radius * radius) continue;
+
+                        if (linked(block.firstId + i, block.firstId + j)){
+                            writeFootway({block.firstId + i, block.firstId + j});
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*function writes the whole map: every node, then every way*/
+void Generator::write(){
+
+    static const char* Words[] = {
+        "Science", "Engineering", "Hall", "Library", "Student", "Center", "Research", "Medical",
+        "Arts", "Business", "Laboratory", "Physics", "Chemistry", "Recreation", "Residence",
+        "Theatre", "Music", "Education", "Pavilion", "Annex", "North", "South", "East", "West"
+    };
+    const int NumWords = sizeof(Words) / sizeof(Words[0]);
+
+    fprintf(out, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    fprintf(out, "<osm version=\"0.6\" generator=\"osmgen\">\n");
+
+    for (const Block& block : blocks){
+        for (long long i = 0; i < block.count; i++){
+            double lat, lon;
+            position(block, i, lat, lon);
+            writeNode(block.firstId + i, lat, lon);
+        }
+    }
+
+    // each building is a small square beside a random node, with corner nodes of its own
+    long long buildingNodeId = options.nodes + 1;
+
+    for (long long b = 0; b < options.buildings && options.nodes > 0; b++){
+
+        const Block& block = blocks[b % blocks.size()];
+        if (block.count == 0) continue;
+
+        double lat, lon;
+        position(block, mix(options.seed, 4, b) % block.count, lat, lon);
+        lat += Spacing / 3;
+        lon += lonSpacing / 3;
+
+        writeNode(buildingNodeId + 4 * b,     lat,               lon);
+        writeNode(buildingNodeId + 4 * b + 1, lat,               lon + lonSpacing / 3);
+        writeNode(buildingNodeId + 4 * b + 2, lat + Spacing / 3, lon + lonSpacing / 3);
+        writeNode(buildingNodeId + 4 * b + 3, lat + Spacing / 3, lon);
+    }
+
+    for (const Block& block : blocks){
+        if (grid()) gridFootways(block);
+        else geometricFootways(block);
+    }
+
+    for (long long b = 0; b < options.buildings && options.nodes > 0; b++){
+
+        if (blocks[b % blocks.size()].count == 0) continue;
+
+        string name, abbrev;
+        int length = 2 + mix(options.seed, 5, b) % 3;
+        for (int w = 0; w < length; w++){
+            const char* word = Words[mix(options.seed, 6, b, w) % NumWords];
+            name += (w ? " " : "") + string(word);
+            abbrev += word[0];
+        }
+        // numbered, so every abbreviation is unique
+        name += " " + to_string(b + 1);
+        abbrev += to_string(b + 1);
+
+        fprintf(out, " <way id=\"%lld\">", nextWayId++);
+        for (int corner : {0, 1, 2, 3, 0}){
+            fprintf(out, "<nd ref=\"%lld\"/>", buildingNodeId + 4 * b + corner);
+        }
+        fprintf(out, "<tag k=\"building\" v=\"university\"/><tag k=\"name\" v=\"%s (%s)\"/></way>\n",
+                name.c_str(), abbrev.c_str());
+    }
+
+    fprintf(out, "</osm>\n");
+}
+
+static void usage(){
+    cerr << "usage: osmgen.exe [--nodes N] [--pattern grid|geometric] [--components C]" << endl
+         << "                  [--density F] [--buildings B] [--seed S] [-o FILE]" << endl;
+}
+
+int main(int argc, char* argv[]) {
+
+    Options options;
+
+    for (int i = 1; i < argc; i++){
+        string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--nodes" && hasValue) options.nodes = atoll(argv[++i]);
+        else if (arg == "--pattern" && hasValue) options.pattern = argv[++i];
+        else if (arg == "--components" && hasValue) options.components = atoi(argv[++i]);
+        else if (arg == "--density" && hasValue) options.density = atof(argv[++i]);
+        else if (arg == "--buildings" && hasValue) options.buildings = atoll(argv[++i]);
+        else if (arg == "--seed" && hasValue) options.seed = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "-o" && hasValue) options.output = argv[++i];
+        else{
+            usage();
+            return 1;
+        }
+    }
+
+    if ((options.pattern != "grid" && options.pattern != "geometric") || options.nodes < 0 ||
+        options.components < 1 || options.buildings < 0){
+        usage();
+        return 1;
+    }
+
+    FILE* out = options.output.empty() ? stdout : fopen(options.output.c_str(), "w");
+    if (out == nullptr){
+        cerr << "**Error: unable to write '" << options.output << "'" << endl;
+        return 1;
+    }
+
+    // large writes: the file is written once, front to back
+    static char buffer[1 << 20];
+    setvbuf(out, buffer, _IOFBF, sizeof(buffer));
+
+    Generator generator(options, out);
+    generator.write();
+
+    bool ok = (fflush(out) == 0);
+    if (out != stdout) ok = (fclose(out) == 0) && ok;
+
+    if (!ok){
+        cerr << "**Error: writing the map failed" << endl;
+        return 1;
+    }
+
+    return 0;
+}
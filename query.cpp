@@ -0,0 +1,361 @@
+// query.cpp
+//
+// Helper functions for the meeting point query, and the query itself.
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+
+#include "query.h"
+#include "dist.h"
+#include "stats.h"
+
+using namespace std;
+
+/*function finds the building that matches a name or abbreviation: by abbreviation
+first, then by partial or full name, then by the closest name for misspellings and
+shortened words
+Takes 2 parameters:
+    1. Names: the name index over the buildings
+    2. name: the name or abbreviation given
+Returns the building's index, or -1 if none matches*/
+int findBuilding(const BuildingIndex& Names, const string& name){
+
+    int b = Names.find(name);
+    if (b < 0) b = Names.findClosest(name);
+
+    return b;
+}
+
+/*fucntion finds the buildings that matches the names or abbreviations given by the user
+if a building is found, its corresponding BuildingInfo parameter is changed
+Takes 8 parameters:
+    1. Buildings: a vector of buildings to search from
+    2. Names: the name index over Buildings
+    3, 4. person1Building, person2Building: the names or abbreviations given
+    5, 6. building1, building2: the BuildingInfo structs storing the found buildings
+    7, 8. build1Found, build2Found: flag variables keeping track if a building is found
+No returns*/
+void findBuildings(const vector<BuildingInfo>& Buildings, const BuildingIndex& Names,
+                   const string& person1Building, const string& person2Building,
+                   BuildingInfo& building1, BuildingInfo& building2,
+                   bool& build1Found, bool& build2Found){
+
+    STAT_TIMER(Phase::FindBuildings);
+
+    if (!build1Found){
+        int b = findBuilding(Names, person1Building);
+        if (b >= 0){
+            building1 = Buildings[b];
+            build1Found = true;
+        }
+    }
+
+    if (!build2Found){
+        int b = findBuilding(Names, person2Building);
+        if (b >= 0){
+            building2 = Buildings[b];
+            build2Found = true;
+        }
+    }
+}
+
+/*function finds the destination/center building of two buildings
+Takes 5 parameters:
+    1. Buildings: a vector of buildings to search from
+    2. buildingPoints: the positions of Buildings, for the batch distance kernels
+    3, 4. building1, building2: the starting buildings
+    5. usedBuildings: a set of buildings already chosen and tried as the destination
+returns the destination building*/
+BuildingInfo findDestinationBuilding(const vector<BuildingInfo>& Buildings, const PointArrays& buildingPoints,
+                                     const BuildingInfo& building1, const BuildingInfo& building2,
+                                     set<string>& usedBuildings){
+
+    STAT_TIMER(Phase::FindDestinationBuilding);
+
+    // calculates the center between building1 and building2
+    Coordinates center = centerBetween2Points(building1.Coords.Lat, building1.Coords.Lon, building2.Coords.Lat, building2.Coords.Lon);
+
+    // distance of every building to the center, in one batch
+    vector<double> dists(buildingPoints.size());
+    distToPoint(buildingPoints, toTrigPoint(center.Lat, center.Lon), dists.data());
+
+    // searches through Buildings to find the building closest to the center
+    size_t centerBuilding = 0;
+    double closestDist = dists.at(0);
+    for (size_t i = 0; i < Buildings.size(); i++){
+
+        // buildings already used are skipped
+        if (usedBuildings.count(Buildings[i].Fullname)) continue;
+
+        if (dists[i] < closestDist){
+            centerBuilding = i;
+            closestDist = dists[i];
+        }
+
+    }
+
+    usedBuildings.emplace(Buildings[centerBuilding].Fullname);
+    return Buildings[centerBuilding];
+
+}
+
+/*function finds the closest nodes on a footway to each of the 2 starting buildings and destination building
+Takes 5 parameters:
+    1. data: the loaded map
+    2 - 4. building1, building2, center: the 3 buildings
+    5. closestNodes: the vector to store the 3 nodes
+No returns*/
+void findNearestNodes(const MapData& data,
+                      const BuildingInfo& building1, const BuildingInfo& building2, const BuildingInfo& center,
+                      vector<long long>& closestNodes){
+
+    STAT_TIMER(Phase::FindNearestNodes);
+
+    for (const BuildingInfo* building : {&building1, &building2, &center}){
+        closestNodes.push_back(findNearestNode(data, *building));
+    }
+}
+
+/*function finds the closest node on a footway to one building, under the map's distance model
+Takes 2 parameters:
+    1. data: the loaded map
+    2. building: the building
+Returns the ID of the node*/
+long long findNearestNode(const MapData& data, const BuildingInfo& building){
+
+    double lat = building.Coords.Lat, lon = building.Coords.Lon;
+    size_t closest;
+
+    if (data.Model == DistanceModel::Equirectangular){
+        closest = data.Planar.nearest(data.Planar.prepare(lat, lon), data.FootwayPlanar);
+    }
+    else{
+        // the spherical models rank by chord length alike, so no trig is done per node
+        SphericalCosines spherical;
+        closest = spherical.nearest(spherical.prepare(lat, lon), data.FootwayVectors);
+    }
+
+    // every footway node is compared
+    STAT_COUNT(Counter::NearestCandidates, data.FootwayNodeIds.size());
+
+    return data.FootwayNodeIds.at(closest);
+}
+
+/*function estimates the bytes a meeting result owns, for the cache's accounting
+Takes 1 parameter:
+    result: the result
+Returns the size in bytes*/
+size_t meetingResultBytes(const MeetingResult& result){
+
+    size_t bytes = sizeof(MeetingResult);
+
+    for (const BuildingInfo* building : {&result.building1, &result.building2, &result.destination}){
+        bytes += building->Fullname.capacity() + building->Abbrev.capacity();
+    }
+
+    bytes += (result.nearestNodes.capacity() + result.path1.capacity() + result.path2.capacity()) * sizeof(long long);
+
+    return bytes;
+}
+
+/*function swaps person 1 and person 2 in a meeting result
+Takes 1 parameter:
+    result: the result to swap
+No returns*/
+static void swapPeople(MeetingResult& result){
+
+    swap(result.build1Found, result.build2Found);
+    swap(result.building1, result.building2);
+    swap(result.path1Distance, result.path2Distance);
+    swap(result.path1, result.path2);
+
+    if (result.nearestNodes.size() >= 2){
+        swap(result.nearestNodes[0], result.nearestNodes[1]);
+    }
+}
+
+/*function answers one meeting point query
+Takes 5 parameters:
+    1. data: the loaded map
+    2, 3. person1Building, person2Building: the names or abbreviations given
+    4. ws: the search workspace owned by the calling thread
+    5. cache: if not null, results are looked up in and added to this cache
+    6. trace: if not null, each stage of the query is timed into it
+Returns the result of the query*/
+MeetingResult findMeetingPoint(const MapData& data,
+                               const string& person1Building, const string& person2Building,
+                               SearchWorkspace& ws, MeetingCache* cache, QueryTrace* trace){
+
+    MeetingResult result;
+
+    //finds starting buildings
+    {
+        StageTimer timer(trace, TraceStage::FindBuildings);
+        findBuildings(data.Buildings, data.BuildingNames, person1Building, person2Building,
+                      result.building1, result.building2, result.build1Found, result.build2Found);
+    }
+
+    if (!result.build1Found || !result.build2Found){
+        return result;
+    }
+
+    // the cache stores each pair once, with the lower building ID as person 1
+    long long id1 = result.building1.Coords.ID, id2 = result.building2.Coords.ID;
+    bool swapped = id2 < id1;
+    pair<long long, long long> key = swapped ? pair(id2, id1) : pair(id1, id2);
+
+    if (cache){
+        StageTimer timer(trace, TraceStage::CacheLookup);
+        shared_ptr<const MeetingResult> cached = cache->get(key);
+        timer.stop();
+
+        if (cached){
+            result = *cached;
+            if (swapped) swapPeople(result);
+            return result;
+        }
+
+        // searches in the cache's order, so the answer does not depend on which order was asked first
+        if (swapped) swapPeople(result);
+    }
+
+    set<string> usedBuildings;
+    bool destReach1 = false, destReach2 = false;
+
+    // do-while loop to repeatedly find a destination building that is reachable from the two starting buildings
+    do{
+
+        if (trace) trace->attempts++;
+
+        result.nearestNodes.clear();
+        {
+            StageTimer timer(trace, TraceStage::FindDestination);
+            result.destination = findDestinationBuilding(data.Buildings, data.BuildingPoints, result.building1, result.building2, usedBuildings);
+        }
+
+        // with precomputed trees, every search below is a lookup
+        if (data.Trees.ready()){
+
+            int building1 = data.Trees.indexOf(result.building1);
+            int building2 = data.Trees.indexOf(result.building2);
+            int destNode = data.Trees.accessNode(data.Trees.indexOf(result.destination));
+
+            for (int b : {building1, building2}){
+                result.nearestNodes.push_back(data.Search.vertexIds[data.Trees.accessNode(b)]);
+            }
+            result.nearestNodes.push_back(data.Search.vertexIds[destNode]);
+
+            StageTimer search1(trace, TraceStage::SearchPerson1);
+            result.reachable = data.Trees.distanceBetween(building1, building2) != INF;
+            if (!result.reachable) break;
+
+            destReach1 = data.Trees.buildPath(data.Trees.treeFor(building1), destNode, result.path1, result.path1Distance);
+            search1.stop();
+            if (!destReach1) continue;
+
+            StageTimer search2(trace, TraceStage::SearchPerson2);
+            destReach2 = data.Trees.buildPath(data.Trees.treeFor(building2), destNode, result.path2, result.path2Distance);
+            continue;
+        }
+
+        {
+            StageTimer timer(trace, TraceStage::FindNearestNodes);
+            findNearestNodes(data, result.building1, result.building2, result.destination, result.nearestNodes);
+        }
+
+        int node1 = data.Search.indexOf(result.nearestNodes.at(0));
+        int node2 = data.Search.indexOf(result.nearestNodes.at(1));
+        int destNode = data.Search.indexOf(result.nearestNodes.at(2));
+
+        // one search from person 1 answers both if person 2 is reachable and the path to the destination
+        StageTimer search1(trace, TraceStage::SearchPerson1);
+        dijkstra(node1, data.Search, ws);
+        result.reachable = ws.distanceTo(node2) != INF;
+
+        //if a path from building1 to building2 does not exist, immediately stop searching
+        if (!result.reachable) break;
+
+        destReach1 = buildPath(destNode, data.Search, ws, result.path1, result.path1Distance);
+        search1.stop();
+        if (!destReach1) continue;
+
+        StageTimer search2(trace, TraceStage::SearchPerson2);
+        dijkstra(node2, data.Search, ws);
+        destReach2 = buildPath(destNode, data.Search, ws, result.path2, result.path2Distance);
+
+    } while (!destReach1 && !destReach2);
+
+    if (cache){
+        cache->put(key, result);
+        if (swapped) swapPeople(result);
+    }
+
+    return result;
+}
+
+/*function answers one path query: the cheapest walk between two buildings under a cost profile
+Takes 5 parameters:
+    1. data: the loaded map
+    2, 3. person1Building, person2Building: the names or abbreviations given
+    4. ws: the search workspace owned by the calling thread
+    5. profile: what the walk minimizes, its length by default
+Returns the result of the query*/
+PathResult findBuildingPath(const MapData& data,
+                            const string& person1Building, const string& person2Building,
+                            SearchWorkspace& ws, CostProfile profile){
+
+    PathResult result;
+    result.profile = profile;
+
+    findBuildings(data.Buildings, data.BuildingNames, person1Building, person2Building,
+                  result.building1, result.building2, result.build1Found, result.build2Found);
+
+    if (!result.build1Found || !result.build2Found){
+        return result;
+    }
+
+    // the precomputed trees are of shortest paths
+    if (data.Trees.ready() && profile == CostProfile::Distance){
+
+        int building1 = data.Trees.indexOf(result.building1);
+        int building2 = data.Trees.indexOf(result.building2);
+
+        result.nearestNodes.push_back(data.Search.vertexIds[data.Trees.accessNode(building1)]);
+        result.nearestNodes.push_back(data.Search.vertexIds[data.Trees.accessNode(building2)]);
+
+        result.reachable = data.Trees.buildPath(data.Trees.treeFor(building1), data.Trees.accessNode(building2),
+                                                result.path, result.distance);
+        result.cost = result.distance;
+        return result;
+    }
+
+    // building 2 doubles as the "center", its nearest node is found twice
+    findNearestNodes(data, result.building1, result.building2, result.building2, result.nearestNodes);
+    result.nearestNodes.pop_back();
+
+    int node1 = data.Search.indexOf(result.nearestNodes.at(0));
+    int node2 = data.Search.indexOf(result.nearestNodes.at(1));
+
+    if (profile == CostProfile::Distance){
+        dijkstra(node1, data.Search, ws);
+        result.reachable = buildPath(node2, data.Search, ws, result.path, result.distance);
+        result.cost = result.distance;
+        return result;
+    }
+
+    dijkstra(profile, node1, data.Search, ws);
+    result.reachable = buildPath(node2, data.Search, ws, result.path, result.cost);
+
+    // the path's length, from the distances of the edges it takes
+    if (result.reachable){
+        result.distance = 0;
+        for (size_t i = 0; i + 1 < result.path.size(); i++){
+            int u = data.Search.indexOf(result.path[i]);
+            result.distance += data.Search.weights[data.Search.edgeBetween(u, data.Search.indexOf(result.path[i + 1]))];
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,108 @@
+// query.h
+//
+// The meeting point query: given two buildings, finds the building closest to
+// their midpoint that both people can walk to, and the shortest path for each.
+// Queries only read the MapData, so any number can run at once as long as each
+// thread passes its own SearchWorkspace.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+
+#include "osm.h"
+#include "mapdata.h"
+#include "search.h"
+#include "cache.h"
+#include "trace.h"
+
+using namespace std;
+
+//
+// MeetingResult
+//
+// The answer to one query. The nearest nodes are (person 1, person 2, destination),
+// and each path runs from a person's nearest node to the destination's.
+//
+struct MeetingResult
+{
+  bool build1Found = false;
+  bool build2Found = false;
+  BuildingInfo building1;
+  BuildingInfo building2;
+  BuildingInfo destination;
+
+  vector<long long> nearestNodes;
+
+  bool reachable = false;
+  double path1Distance = INF;
+  double path2Distance = INF;
+  vector<long long> path1;
+  vector<long long> path2;
+};
+
+//
+// MeetingCache
+//
+// Meeting results keyed by the pair of building IDs in ascending order. A query
+// for (B, A) is answered from the entry for (A, B) with the two people swapped.
+// When a cache is used, the search itself always runs in ascending ID order, so
+// answers never depend on which order a pair was first asked in (the midpoint can
+// be equally close to both buildings, and rounding then picks the destination).
+//
+struct BuildingPairHash
+{
+  size_t operator()(const pair<long long, long long>& key) const {
+    return hash<long long>()(key.first) * 31 + hash<long long>()(key.second);
+  }
+};
+
+typedef LRUCache<pair<long long, long long>, MeetingResult, BuildingPairHash> MeetingCache;
+
+size_t meetingResultBytes(const MeetingResult& result);
+
+//
+// PathResult
+//
+// The answer to a path query: the cheapest walk under a cost profile, by default
+// the shortest, from building 1's nearest node to building 2's. The nearest nodes
+// are (person 1, person 2). distance is the walk's length in miles whatever the
+// profile, and cost its cost in the profile's units.
+//
+struct PathResult
+{
+  bool build1Found = false;
+  bool build2Found = false;
+  BuildingInfo building1;
+  BuildingInfo building2;
+
+  vector<long long> nearestNodes;
+
+  bool reachable = false;
+  double distance = INF;
+  vector<long long> path;
+
+  CostProfile profile = CostProfile::Distance;
+  double cost = INF;
+};
+
+int findBuilding(const BuildingIndex& Names, const string& name);
+void findBuildings(const vector<BuildingInfo>& Buildings, const BuildingIndex& Names,
+                   const string& person1Building, const string& person2Building,
+                   BuildingInfo& building1, BuildingInfo& building2,
+                   bool& build1Found, bool& build2Found);
+BuildingInfo findDestinationBuilding(const vector<BuildingInfo>& Buildings, const PointArrays& buildingPoints,
+                                     const BuildingInfo& building1, const BuildingInfo& building2,
+                                     set<string>& usedBuildings);
+void findNearestNodes(const MapData& data,
+                      const BuildingInfo& building1, const BuildingInfo& building2, const BuildingInfo& center,
+                      vector<long long>& closestNodes);
+long long findNearestNode(const MapData& data, const BuildingInfo& building);
+MeetingResult findMeetingPoint(const MapData& data,
+                               const string& person1Building, const string& person2Building,
+                               SearchWorkspace& ws, MeetingCache* cache = nullptr, QueryTrace* trace = nullptr);
+PathResult findBuildingPath(const MapData& data,
+                            const string& person1Building, const string& person2Building,
+                            SearchWorkspace& ws, CostProfile profile = CostProfile::Distance);
@@ -0,0 +1,107 @@
+// reload.cpp
+//
+// Implementation of map snapshots and the MapWatcher thread.
+
+#include <iostream>
+#include <sys/stat.h>
+
+#include "reload.h"
+#include "osmchange.h"
+
+using namespace std;
+
+shared_ptr<const MapData> loadMapSnapshot(const MapSource& source){
+
+    auto data = make_shared<MapData>();
+    data->Ways = source.ways;
+
+    if (!loadMapData(source.filename, *data, source.model, source.maxRelError)){
+        return nullptr;
+    }
+
+    for (const string& changeFilename : source.changeFilenames){
+        OsmChangeStats stats;
+        if (!applyOsmChange(changeFilename, *data, stats)) return nullptr;
+    }
+
+    if (source.precompute){
+        data->Trees.build(*data, source.numThreads);
+    }
+
+    return data;
+}
+
+MapWatcher::MapWatcher(QueryEngine& engine, const MapSource& source)
+    : engine(engine), source(source) {
+
+    // the map being served was loaded from the file as it is now
+    _Stat(lastModified, lastSize);
+
+    watcher = thread(&MapWatcher::watchLoop, this);
+}
+
+MapWatcher::~MapWatcher(){
+
+    {
+        lock_guard<mutex> guard(stopLock);
+        stopping = true;
+    }
+    stopSignal.notify_all();
+
+    watcher.join();
+}
+
+bool MapWatcher::_Stat(timespec& modified, long long& size) const {
+
+    struct stat info;
+
+    if (stat(source.filename.c_str(), &info) != 0){
+        return false;
+    }
+
+    modified = info.st_mtim;
+    size = info.st_size;
+    return true;
+}
+
+/*function run by the watcher thread: polls the file, and reloads it whenever its
+modification time or size changes
+No parameters
+No returns*/
+void MapWatcher::watchLoop(){
+
+    while (true){
+
+        {
+            unique_lock<mutex> guard(stopLock);
+            if (stopSignal.wait_for(guard, source.watchInterval, [this]{ return stopping; })) return;
+        }
+
+        timespec modified;
+        long long size;
+
+        if (!_Stat(modified, size)) continue; // being replaced; look again next time
+
+        if (modified.tv_sec == lastModified.tv_sec && modified.tv_nsec == lastModified.tv_nsec && size == lastSize){
+            continue;
+        }
+
+        // a file that fails to load is not retried until it changes again
+        lastModified = modified;
+        lastSize = size;
+
+        auto start = chrono::steady_clock::now();
+        shared_ptr<const MapData> data = loadMapSnapshot(source);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        if (!data){
+            cout << "**Error: unable to reload '" << source.filename << "'; still serving the previous map." << endl;
+            continue;
+        }
+
+        unsigned version = engine.swapMap(data);
+
+        cout << "Reloaded '" << source.filename << "' as map version " << version << " in " << ms << " ms ("
+             << data->Nodes.size() << " nodes, " << data->G.NumEdges() << " edges)" << endl;
+    }
+}
@@ -0,0 +1,86 @@
+// reload.h
+//
+// Hot map reloading. A MapWatcher checks the map file's modification time on a
+// background thread; when it changes, the file is loaded into a brand new MapData
+// on that thread, and the finished map is swapped into the QueryEngine. Queries
+// keep being answered from the old map while the new one is built, and those
+// already running when the swap happens finish on the old map.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <ctime>
+
+#include "mapdata.h"
+#include "engine.h"
+
+using namespace std;
+
+//
+// MapSource
+//
+// Everything needed to load the map again the way it was loaded at startup.
+// Maps are only watched when watchInterval is not zero.
+//
+struct MapSource
+{
+  string filename;
+  DistanceModel model = DistanceModel::SphericalCosines;
+  double maxRelError = 1e-3;
+  WayFilter ways;  // the highway values read as footways
+  vector<string> changeFilenames;  // osmChange files applied after loading, in order
+  bool precompute = false;
+  unsigned numThreads = 0;  // for precomputing
+  chrono::milliseconds watchInterval{0};
+};
+
+//
+// loadMapSnapshot
+//
+// Loads and prepares a map from source. Returns null if the file could not be
+// loaded.
+//
+shared_ptr<const MapData> loadMapSnapshot(const MapSource& source);
+
+class MapWatcher {
+    private:
+
+        QueryEngine& engine;
+        MapSource source;
+
+        thread watcher;
+        mutex stopLock;
+        condition_variable stopSignal;
+        bool stopping = false;
+
+        timespec lastModified{};
+        long long lastSize = -1;
+
+        // reads the file's modification time and size; returns false if it is missing
+        bool _Stat(timespec& modified, long long& size) const;
+
+        void watchLoop();
+
+    public:
+
+        //
+        // constructor:
+        // starts watching source.filename, every source.watchInterval
+        //
+        MapWatcher(QueryEngine& engine, const MapSource& source);
+
+        MapWatcher(const MapWatcher&) = delete;
+        MapWatcher& operator=(const MapWatcher&) = delete;
+
+        //
+        // destructor:
+        // stops watching, waiting for a reload in progress to finish
+        //
+        ~MapWatcher();
+};
@@ -0,0 +1,133 @@
+// routes.cpp
+//
+// Penalized searches, and the choice of which routes they find to keep.
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "routes.h"
+#include "query.h"
+
+using namespace std;
+
+// one key for both directions of an edge between two vertices
+static long long undirectedKey(int u, int v){
+    return (static_cast<long long>(min(u, v)) << 32) | static_cast<unsigned>(max(u, v));
+}
+
+void findRoutes(const SearchGraph& G, int start, int destination, const RouteOptions& options,
+                SearchWorkspace& ws, vector<Route>& routes){
+
+    routes.clear();
+
+    if (start == destination){
+        routes.push_back(Route{{G.vertexIds[start]}, 0});
+        return;
+    }
+
+    if ((int)ws.edgeFactor.size() != G.numEdges()){
+        ws.edgeFactor.assign(G.numEdges(), 1.0);
+    }
+
+    int maxSearches = options.maxSearches > 0 ? options.maxSearches : 4 * options.k;
+
+    vector<int> penalized;                     // edges whose factor was raised, to put back
+    vector<unordered_set<long long>> keptEdges; // per route kept, its edges
+    double shortest = INF;
+
+    for (int search = 0; search < maxSearches && (int)routes.size() < options.k; search++){
+
+        dijkstraBy<PenalizedDistanceCost>(start, G, ws, INF, nullptr, destination);
+        if (ws.distanceTo(destination) == INF) break;
+
+        vector<int> vertices;
+        for (int v = destination; v != -1; v = ws.predecessorOf(v)){
+            vertices.push_back(v);
+        }
+        reverse(vertices.begin(), vertices.end());
+
+        // the route's real length, without the penalties
+        vector<int> edges;
+        double length = 0;
+        for (size_t i = 0; i + 1 < vertices.size(); i++){
+            int e = G.edgeBetween(vertices[i], vertices[i + 1]);
+            edges.push_back(e);
+            length += G.weights[e];
+        }
+
+        if (routes.empty()) shortest = length;
+
+        bool keep = length <= shortest * options.maxStretch;
+
+        for (size_t r = 0; keep && r < keptEdges.size(); r++){
+            double shared = 0;
+            for (size_t i = 0; i < edges.size(); i++){
+                if (keptEdges[r].count(undirectedKey(vertices[i], vertices[i + 1]))) shared += G.weights[edges[i]];
+            }
+
+            keep = shared <= (1 - options.minDissimilarity) * length;
+        }
+
+        if (keep){
+            Route route;
+            route.distance = length;
+            for (int v : vertices) route.path.push_back(G.vertexIds[v]);
+            routes.push_back(std::move(route));
+
+            keptEdges.emplace_back();
+            for (size_t i = 0; i < edges.size(); i++){
+                keptEdges.back().insert(undirectedKey(vertices[i], vertices[i + 1]));
+            }
+        }
+
+        // the next search avoids this route, in both directions, whether it was kept or not
+        for (size_t i = 0; i < edges.size(); i++){
+            int back = G.edgeBetween(vertices[i + 1], vertices[i]);
+
+            for (int e : {edges[i], back}){
+                if (e < 0) continue;
+                ws.edgeFactor[e] *= 1 + options.penalty;
+                penalized.push_back(e);
+            }
+        }
+    }
+
+    for (int e : penalized){
+        ws.edgeFactor[e] = 1.0;
+    }
+}
+
+/*function answers one alternative routes query between two buildings
+Takes 5 parameters:
+    1. data: the loaded map
+    2, 3. person1Building, person2Building: the names or abbreviations given
+    4. options: how many routes to find, and which to keep
+    5. ws: the search workspace owned by the calling thread
+Returns the result of the query*/
+RoutesResult findBuildingRoutes(const MapData& data,
+                                const string& person1Building, const string& person2Building,
+                                const RouteOptions& options, SearchWorkspace& ws){
+
+    RoutesResult result;
+
+    int building1 = findBuilding(data.BuildingNames, person1Building);
+    int building2 = findBuilding(data.BuildingNames, person2Building);
+
+    result.build1Found = (building1 >= 0);
+    result.build2Found = (building2 >= 0);
+    if (!result.build1Found || !result.build2Found){
+        return result;
+    }
+
+    result.building1 = data.Buildings[building1];
+    result.building2 = data.Buildings[building2];
+
+    int start = data.BuildingAccess[building1];
+    int destination = data.BuildingAccess[building2];
+
+    if (start >= 0 && destination >= 0){
+        findRoutes(data.Search, start, destination, options, ws, result.routes);
+    }
+
+    return result;
+}
@@ -0,0 +1,72 @@
+// routes.h
+//
+// Alternative routes between two points, by the penalty method: after each
+// search, the edges of the route found are made more expensive, so the next
+// search is pushed onto other footways. A route is kept if it is not much longer
+// than the shortest and shares little of its length with the routes kept before
+// it. Each search stops once it settles the destination and runs in the caller's
+// SearchWorkspace, so k routes cost a few times k shortest-path searches.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "osm.h"
+#include "mapdata.h"
+#include "search.h"
+
+using namespace std;
+
+//
+// RouteOptions
+//
+// How many routes to find, and what makes a route worth keeping.
+//
+struct RouteOptions
+{
+  int k = 3;                      // routes wanted, the shortest included
+  double minDissimilarity = 0.3;  // share of a route's length it must not share with any kept route
+  double maxStretch = 1.5;        // longest route kept, as a multiple of the shortest
+  double penalty = 0.5;           // weight added to the edges of each route found, as a share of their weight
+  int maxSearches = 0;            // searches tried before giving up; 0 for 4 * k
+};
+
+//
+// Route
+//
+// One walk, as node IDs from start to destination, and its length in miles.
+//
+struct Route
+{
+  vector<long long> path;
+  double distance = INF;
+};
+
+//
+// findRoutes
+//
+// Finds up to options.k routes between two Search vertices, shortest first;
+// none if the destination is unreachable.
+//
+void findRoutes(const SearchGraph& G, int start, int destination, const RouteOptions& options,
+                SearchWorkspace& ws, vector<Route>& routes);
+
+//
+// RoutesResult
+//
+// The answer to an alternative routes query between two buildings, from
+// building 1's nearest node to building 2's.
+//
+struct RoutesResult
+{
+  bool build1Found = false;
+  bool build2Found = false;
+  BuildingInfo building1;
+  BuildingInfo building2;
+  vector<Route> routes;
+};
+
+RoutesResult findBuildingRoutes(const MapData& data,
+                                const string& person1Building, const string& person2Building,
+                                const RouteOptions& options, SearchWorkspace& ws);
@@ -0,0 +1,329 @@
+// search.cpp
+//
+// Builds the SearchGraph view of a graph<> and runs Dijkstra's algorithm over it,
+// once per cost profile.
+
+#include <algorithm>
+#include <functional>
+
+#include "search.h"
+#include "stats.h"
+
+using namespace std;
+
+//
+// indexOf
+//
+// binary searches the sorted vertex IDs for id
+//
+int SearchGraph::indexOf(long long id) const {
+
+    auto it = lower_bound(vertexIds.begin(), vertexIds.end(), id);
+
+    if (it == vertexIds.end() || *it != id){
+        return -1;
+    }
+
+    return static_cast<int>(it - vertexIds.begin());
+}
+
+//
+// edgeBetween
+//
+// scans u's edges, which are few on a footway graph
+//
+int SearchGraph::edgeBetween(int u, int v) const {
+
+    for (int e = offsets[u]; e < offsets[u + 1]; e++){
+        if (targets[e] == v) return e;
+    }
+
+    return -1;
+}
+
+//
+// reset
+//
+// grows the arrays to fit the graph and starts a new round. The stamps are only
+// cleared when the round counter wraps around.
+//
+void SearchWorkspace::reset(int numVertices){
+
+    if ((int)distance.size() != numVertices){
+        distance.assign(numVertices, INF);
+        predecessor.assign(numVertices, -1);
+        reachedRound.assign(numVertices, 0);
+        settledRound.assign(numVertices, 0);
+        round = 0;
+    }
+
+    round++;
+
+    if (round == 0){
+        fill(reachedRound.begin(), reachedRound.end(), 0);
+        fill(settledRound.begin(), settledRound.end(), 0);
+        round = 1;
+    }
+
+    heap.clear();
+}
+
+/*function copies a graph into the adjacency arrays of a SearchGraph
+Takes 2 parameters:
+    1. G: the graph to copy
+    2. S: the SearchGraph to fill
+No returns*/
+void buildSearchGraph(const graph<long long, double>& G, SearchGraph& S){
+
+    S.vertexIds = G.getVertices();  // already sorted, since graph<> stores vertices in a map
+    S.offsets.assign(1, 0);
+    S.targets.clear();
+    S.weights.clear();
+
+    S.offsets.reserve(S.vertexIds.size() + 1);
+    S.targets.reserve(G.NumEdges());
+    S.weights.reserve(G.NumEdges());
+
+    for (long long vertex : S.vertexIds){
+
+        // neighbors are added in sorted order, the same order graph<> iterates them
+        for (long long n : G.neighbors(vertex)){
+            double weight = INF;
+            G.getWeight(vertex, n, weight);
+
+            S.targets.push_back(S.indexOf(n));
+            S.weights.push_back(weight);
+        }
+
+        S.offsets.push_back(static_cast<int>(S.targets.size()));
+    }
+}
+
+/*function works out one edge's cost under each profile besides Distance
+Takes 3 parameters:
+    1. S: the SearchGraph, whose costs are sized and whose weight and class of e are set
+    2. e: the edge
+    3. ways: the way classes, with their speed factors
+No returns*/
+static void setEdgeCosts(SearchGraph& S, int e, const WayFilter& ways){
+
+    int wayClass = S.edgeClasses[e];
+    double speedFactor = (wayClass == WayFilter::NotWalked) ? 1.0 : ways.speedFactorOf(wayClass);
+    bool stairs = (wayClass != WayFilter::NotWalked) && ways.isStairs(wayClass);
+
+    double* costs = &S.costs[static_cast<size_t>(e) * CostColumns];
+    costs[WalkingTimeCost::Column] = WalkingTimeCost::of(S.weights[e], speedFactor, stairs);
+    costs[AvoidStairsCost::Column] = AvoidStairsCost::of(S.weights[e], speedFactor, stairs);
+    costs[AccessibleCost::Column] = AccessibleCost::of(S.weights[e], speedFactor, stairs);
+}
+
+/*function works out every edge's cost under each profile besides Distance
+Takes 2 parameters:
+    1. S: the SearchGraph, whose weights and edge classes are set
+    2. ways: the way classes, with their speed factors
+No returns*/
+void buildSearchCosts(SearchGraph& S, const WayFilter& ways){
+
+    S.costs.assign(static_cast<size_t>(S.numEdges()) * CostColumns, 0);
+
+    for (int e = 0; e < S.numEdges(); e++){
+        setEdgeCosts(S, e, ways);
+    }
+}
+
+/*function updates a SearchGraph after some of its graph's vertices changed. The rows of
+untouched vertices are copied as they are, which is a few memory moves per edge; only
+the touched vertices' edges are read from the graph<>, whose lookups are what make a
+full build slow
+Takes 5 parameters:
+    1. G: the changed graph
+    2. touched: the node IDs whose edges were added, removed or reweighted, and the
+       vertices added or removed
+    3. classOf: the way class of an edge of a touched vertex, given its previous class
+    4. ways: the way classes, with their speed factors
+    5. S: the SearchGraph built from G before it changed, updated in place
+No returns*/
+void patchSearchGraph(const graph<long long, double>& G, const unordered_set<long long>& touched,
+                      const function<int(long long, long long, int)>& classOf, const WayFilter& ways,
+                      SearchGraph& S){
+
+    SearchGraph old = std::move(S);
+
+    S.vertexIds = G.getVertices();
+
+    // the new index of every old vertex and the old index of every new one, -1 for
+    // those removed and added
+    vector<int> newIndex(old.numVertices(), -1), oldIndex(S.numVertices(), -1);
+    for (int i = 0, j = 0; i < old.numVertices() && j < S.numVertices(); ){
+        if (old.vertexIds[i] < S.vertexIds[j]) i++;
+        else if (old.vertexIds[i] > S.vertexIds[j]) j++;
+        else{
+            newIndex[i] = j;
+            oldIndex[j++] = i++;
+        }
+    }
+
+    S.offsets.assign(1, 0);
+    S.offsets.reserve(S.vertexIds.size() + 1);
+    S.targets.reserve(G.NumEdges());
+    S.weights.reserve(G.NumEdges());
+    S.edgeClasses.reserve(G.NumEdges());
+    S.costs.reserve(static_cast<size_t>(G.NumEdges()) * CostColumns);
+
+    for (int v = 0; v < S.numVertices(); v++){
+
+        long long id = S.vertexIds[v];
+        int u = oldIndex[v];
+
+        if (u >= 0 && !touched.count(id)){
+
+            // a removed vertex's neighbors are touched, so every target is still a vertex
+            for (int e = old.offsets[u]; e < old.offsets[u + 1]; e++){
+                S.targets.push_back(newIndex[old.targets[e]]);
+                S.weights.push_back(old.weights[e]);
+                S.edgeClasses.push_back(old.edgeClasses[e]);
+            }
+            S.costs.insert(S.costs.end(), old.costs.begin() + static_cast<size_t>(old.offsets[u]) * CostColumns,
+                           old.costs.begin() + static_cast<size_t>(old.offsets[u + 1]) * CostColumns);
+        }
+        else{
+
+            // read from G in the order buildSearchGraph() does
+            for (long long n : G.neighbors(id)){
+                double weight = INF;
+                G.getWeight(id, n, weight);
+
+                int previous = WayFilter::NotWalked;
+                int oldTarget = (u >= 0) ? old.indexOf(n) : -1;
+                int oldEdge = (oldTarget >= 0) ? old.edgeBetween(u, oldTarget) : -1;
+                if (oldEdge >= 0) previous = old.edgeClasses[oldEdge];
+
+                S.targets.push_back(S.indexOf(n));
+                S.weights.push_back(weight);
+                S.edgeClasses.push_back(classOf(id, n, previous));
+                S.costs.resize(S.costs.size() + CostColumns);
+                setEdgeCosts(S, S.numEdges() - 1, ways);
+            }
+        }
+
+        S.offsets.push_back(static_cast<int>(S.targets.size()));
+    }
+}
+
+void dijkstra(int start, const SearchGraph& G, SearchWorkspace& ws, double maxDistance, vector<int>* settled){
+    dijkstraBy<DistanceCost>(start, G, ws, maxDistance, settled);
+}
+
+void dijkstra(CostProfile profile, int start, const SearchGraph& G, SearchWorkspace& ws,
+              double maxCost, vector<int>* settled){
+
+    switch (profile){
+        case CostProfile::WalkingTime:
+            dijkstraBy<WalkingTimeCost>(start, G, ws, maxCost, settled);
+            break;
+        case CostProfile::AvoidStairs:
+            dijkstraBy<AvoidStairsCost>(start, G, ws, maxCost, settled);
+            break;
+        case CostProfile::Accessible:
+            dijkstraBy<AccessibleCost>(start, G, ws, maxCost, settled);
+            break;
+        default:
+            dijkstraBy<DistanceCost>(start, G, ws, maxCost, settled);
+            break;
+    }
+}
+
+/*function performs Dijkstra's algorithm to find the cheapest paths from a start vertex
+under a cost profile; vertices costing more than maxCost are never queued, so a
+bounded search only touches the vertices within reach
+Takes 6 parameters:
+    1. start: the index of the vertex the search starts from
+    2. G: the graph being traversed
+    3. ws: the workspace to store the costs and predecessors in
+    4. maxCost: the highest cost searched
+    5. settled: if not null, the settled vertices are appended to it in the order settled
+    6. target: if not -1, the search stops once this vertex is settled
+No returns*/
+template<typename Profile>
+void dijkstraBy(int start, const SearchGraph& G, SearchWorkspace& ws, double maxCost, vector<int>* settled, int target){
+
+    STAT_TIMER(Phase::Dijkstra);
+
+    ws.reset(G.numVertices());
+
+    auto later = greater<pair<double, int>>();
+
+    ws.distance[start] = 0;
+    ws.predecessor[start] = -1;
+    ws.reachedRound[start] = ws.round;
+    ws.heap.push_back(pair(0.0, start));
+    STAT_COUNT(Counter::HeapPushes, 1);
+
+    while (!ws.heap.empty()){
+
+        // dequeues the closest unsettled vertex
+        pop_heap(ws.heap.begin(), ws.heap.end(), later);
+        pair<double, int> current = ws.heap.back();
+        ws.heap.pop_back();
+        STAT_COUNT(Counter::HeapPops, 1);
+
+        int u = current.second;
+        if (ws.settledRound[u] == ws.round){
+            continue;
+        }
+        ws.settledRound[u] = ws.round;
+        if (settled) settled->push_back(u);
+        STAT_COUNT(Counter::SettledVertices, 1);
+        if (u == target) return;
+        STAT_COUNT(Counter::RelaxedEdges, G.offsets[u + 1] - G.offsets[u]);
+
+        // visits every neighboring vertex and checks if a new shortest distance from start is found
+        for (int e = G.offsets[u]; e < G.offsets[u + 1]; e++){
+
+            int v = G.targets[e];
+            double altTotalDistance = current.first + edgeCost<Profile>(G, ws, e);
+
+            if (altTotalDistance < ws.distanceTo(v) && altTotalDistance <= maxCost){
+                ws.distance[v] = altTotalDistance;
+                ws.predecessor[v] = u;
+                ws.reachedRound[v] = ws.round;
+
+                ws.heap.push_back(pair(altTotalDistance, v));
+                push_heap(ws.heap.begin(), ws.heap.end(), later);
+                STAT_COUNT(Counter::HeapPushes, 1);
+            }
+        }
+    }
+}
+
+template void dijkstraBy<DistanceCost>(int, const SearchGraph&, SearchWorkspace&, double, vector<int>*, int);
+template void dijkstraBy<WalkingTimeCost>(int, const SearchGraph&, SearchWorkspace&, double, vector<int>*, int);
+template void dijkstraBy<AvoidStairsCost>(int, const SearchGraph&, SearchWorkspace&, double, vector<int>*, int);
+template void dijkstraBy<AccessibleCost>(int, const SearchGraph&, SearchWorkspace&, double, vector<int>*, int);
+template void dijkstraBy<PenalizedDistanceCost>(int, const SearchGraph&, SearchWorkspace&, double, vector<int>*, int);
+
+/*function builds the path to a destination from the results of dijkstra()
+Takes 5 parameters:
+    1. destination: the index of the destination vertex
+    2. G: the graph that was searched
+    3. ws: the workspace holding the search results
+    4. path: the vector to store the path's node IDs in, from start to destination
+    5. totDistance: changed to the total distance of the path, INF if there is none
+Returns a boolean value if a path is possible*/
+bool buildPath(int destination, const SearchGraph& G, const SearchWorkspace& ws,
+               vector<long long>& path, double& totDistance){
+
+    STAT_TIMER(Phase::BuildPath);
+
+    totDistance = ws.distanceTo(destination);
+    path.clear();
+
+    if (totDistance == INF) return false;
+
+    for (int v = destination; v != -1; v = ws.predecessorOf(v)){
+        path.push_back(G.vertexIds[v]);
+    }
+
+    reverse(path.begin(), path.end());
+    return true;
+}
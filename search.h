@@ -0,0 +1,132 @@
+// search.h
+//
+// Compact, read-only view of the footway graph used for path finding, and the
+// per-thread workspace that Dijkstra's algorithm runs in. A SearchGraph is built
+// once after loading and can then be shared by any number of threads; each thread
+// owns its own SearchWorkspace, so searches never need to lock.
+
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <functional>
+#include <unordered_set>
+
+#include "graph.h"
+#include "costprofile.h"
+#include "waytags.h"
+
+using namespace std;
+
+const double INF = numeric_limits<double>::max();
+
+//
+// SearchGraph
+//
+// Adjacency arrays (CSR layout) of a graph<long long, double>. Vertices are
+// identified by a dense index, which is their position in vertexIds. The edges
+// leaving vertex i are targets/weights[offsets[i]] ... [offsets[i + 1] - 1].
+// Weights are distances; the other profiles' costs are kept apart from targets
+// and weights, in a strided array of their own: those of edge e are
+// costs[e * CostColumns] ... [e * CostColumns + CostColumns - 1], in the order
+// of the CostProfile values after Distance. A search under one of them reads
+// targets and costs, two streams, just as a distance search reads targets and
+// weights.
+//
+struct SearchGraph
+{
+  vector<long long> vertexIds;  // sorted node IDs
+  vector<int>       offsets;    // size numVertices() + 1
+  vector<int>       targets;
+  vector<double>    weights;
+  vector<double>    costs;      // CostColumns per edge, empty until buildSearchCosts()
+  vector<int>       edgeClasses; // the way class of each edge, WayFilter::NotWalked if none
+
+  int numVertices() const { return static_cast<int>(vertexIds.size()); }
+  int numEdges() const { return static_cast<int>(targets.size()); }
+
+  // returns the dense index of a node ID, or -1 if it is not a vertex
+  int indexOf(long long id) const;
+
+  // returns the index of the edge from vertex u to vertex v, or -1 if there is none
+  int edgeBetween(int u, int v) const;
+};
+
+//
+// SearchWorkspace
+//
+// Scratch state for one search. Entries are only valid for vertices stamped with
+// the current round, so starting a new search does not need to clear the arrays.
+//
+struct SearchWorkspace
+{
+  vector<double>   distance;
+  vector<int>      predecessor;
+  vector<unsigned> reachedRound;
+  vector<unsigned> settledRound;
+  vector<pair<double, int>> heap;
+  unsigned round = 0;
+
+  // per edge weight factors for penalized searches, such as findRoutes(); sized
+  // on first use, and all 1 again once such a search is done
+  vector<double>   edgeFactor;
+
+  // prepares the workspace for a new search over a graph of numVertices vertices
+  void reset(int numVertices);
+
+  double distanceTo(int v) const { return reachedRound[v] == round ? distance[v] : INF; }
+  int predecessorOf(int v) const { return reachedRound[v] == round ? predecessor[v] : -1; }
+};
+
+//
+// PenalizedDistanceCost
+//
+// Distances scaled by the workspace's edgeFactor, for searches that steer away
+// from edges already used, such as findRoutes().
+//
+struct PenalizedDistanceCost
+{
+  static constexpr int Column = -1;
+  static constexpr bool Penalized = true;
+};
+
+// the cost of edge e under a profile
+template<typename Profile>
+inline double edgeCost(const SearchGraph& G, const SearchWorkspace& ws, int e){
+    if constexpr (Profile::Penalized){
+        return G.weights[e] * ws.edgeFactor[e];
+    }
+    else if constexpr (Profile::Column < 0){
+        return G.weights[e];
+    }
+    else{
+        return G.costs[e * CostColumns + Profile::Column];
+    }
+}
+
+void buildSearchGraph(const graph<long long, double>& G, SearchGraph& S);
+// fills S.costs from S.edgeClasses, the class of each edge in ways; an edge of no
+// known class is walked like a footway
+void buildSearchCosts(SearchGraph& S, const WayFilter& ways);
+// updates S after G changed, only reading the edges of the touched vertices from G:
+// every other row is copied, its targets renumbered if vertices came or went.
+// classOf(from, to, previous) gives the class of a touched row's edge, previous
+// being its class before, or WayFilter::NotWalked if it is new
+void patchSearchGraph(const graph<long long, double>& G, const unordered_set<long long>& touched,
+                      const function<int(long long, long long, int)>& classOf, const WayFilter& ways,
+                      SearchGraph& S);
+// with a maxDistance, the search stops at vertices farther than it, and if settled
+// is not null, every settled vertex is appended to it, nearest first
+void dijkstra(int start, const SearchGraph& G, SearchWorkspace& ws,
+              double maxDistance = INF, vector<int>* settled = nullptr);
+// the same search under a cost profile (DistanceCost, WalkingTimeCost, ...): the
+// workspace's distances are then costs in the profile's units. With a target, the
+// search stops as soon as the target is settled
+template<typename Profile>
+void dijkstraBy(int start, const SearchGraph& G, SearchWorkspace& ws,
+                double maxCost = INF, vector<int>* settled = nullptr, int target = -1);
+// the same, choosing the instantiation for a profile known at run time
+void dijkstra(CostProfile profile, int start, const SearchGraph& G, SearchWorkspace& ws,
+              double maxCost = INF, vector<int>* settled = nullptr);
+bool buildPath(int destination, const SearchGraph& G, const SearchWorkspace& ws,
+               vector<long long>& path, double& totDistance);
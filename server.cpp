@@ -0,0 +1,733 @@
+// server.cpp
+//
+// Event loop, connection handling and the JSON replies of the server mode.
+
+#include <iostream>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "server.h"
+#include "engine.h"
+#include "reload.h"
+#include "query.h"
+#include "isochrone.h"
+#include "routes.h"
+#include "stats.h"
+
+using namespace std;
+
+//
+// Reply
+//
+// Slot for the reply to one request. A worker fills in text and then sets done;
+// the event loop only reads text after seeing done.
+//
+struct Reply
+{
+  string text;
+  atomic<bool> done = false;
+};
+
+//
+// Connection
+//
+// A client connection: bytes read but not yet split into lines, replies in
+// request order, and bytes waiting to be written. closing stops it handling
+// requests; hungUp only stops it reading, so lines already read are answered.
+//
+struct Connection
+{
+  int fd = -1;
+  string inBuf;
+  string outBuf;
+  deque<shared_ptr<Reply>> pending;
+  bool closing = false;
+  bool hungUp = false;
+};
+
+// how many buildings a FIND or COMPLETE request suggests
+static const size_t FindResults = 5;
+static const size_t CompleteResults = 8;
+
+// most routes one ROUTES request may ask for
+static const int MaxRoutes = 10;
+
+// longest request line accepted, without its newline; a client that sends a
+// longer one is sent an error and disconnected, so it cannot grow inBuf at will
+static const size_t MaxLineBytes = 64 * 1024;
+
+// most replies a connection may have outstanding, and most reply bytes waiting
+// for it to read; past either, its requests wait unread until it catches up
+static const size_t MaxPendingReplies = 256;
+static const size_t MaxOutBytes = 1024 * 1024;
+
+static volatile sig_atomic_t stopRequested = 0;
+static int wakeupWrite = -1;
+
+static void onStopSignal(int){
+    stopRequested = 1;
+    char c = 0;
+    if (write(wakeupWrite, &c, 1) < 0) { /* loop notices the flag on its next pass */ }
+}
+
+static void setNonBlocking(int fd){
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+//
+// JSON helpers
+//
+static string jsonString(const string& s){
+    string out = "\"";
+
+    for (char c : s){
+        switch (c){
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if ((unsigned char)c < 0x20){
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                }
+                else{
+                    out += c;
+                }
+        }
+    }
+
+    return out + "\"";
+}
+
+static void jsonBuilding(ostream& out, const BuildingInfo& building){
+    out << "{\"name\":" << jsonString(building.Fullname)
+        << ",\"abbrev\":" << jsonString(building.Abbrev)
+        << ",\"lat\":" << building.Coords.Lat
+        << ",\"lon\":" << building.Coords.Lon << "}";
+}
+
+static void jsonPath(ostream& out, double distance, const vector<long long>& path){
+    out << "{\"distance\":" << distance << ",\"nodes\":[";
+
+    for (size_t i = 0; i < path.size(); i++){
+        out << (i ? "," : "") << path[i];
+    }
+
+    out << "]}";
+}
+
+static string jsonError(const string& message){
+    return "{\"ok\":false,\"error\":" + jsonString(message) + "}";
+}
+
+static string jsonNotFound(bool build1Found){
+    return jsonError(!build1Found ? "Person 1's building not found" : "Person 2's building not found");
+}
+
+static string meetingReply(const MeetingResult& result){
+
+    if (!result.build1Found || !result.build2Found){
+        return jsonNotFound(result.build1Found);
+    }
+
+    ostringstream out;
+    out << setprecision(10);
+
+    out << "{\"ok\":true,\"building1\":";
+    jsonBuilding(out, result.building1);
+    out << ",\"building2\":";
+    jsonBuilding(out, result.building2);
+    out << ",\"destination\":";
+    jsonBuilding(out, result.destination);
+    out << ",\"reachable\":" << (result.reachable ? "true" : "false");
+
+    if (result.reachable){
+        out << ",\"path1\":";
+        jsonPath(out, result.path1Distance, result.path1);
+        out << ",\"path2\":";
+        jsonPath(out, result.path2Distance, result.path2);
+    }
+
+    out << "}";
+    return out.str();
+}
+
+static string pathReply(const PathResult& result){
+
+    if (!result.build1Found || !result.build2Found){
+        return jsonNotFound(result.build1Found);
+    }
+
+    ostringstream out;
+    out << setprecision(10);
+
+    out << "{\"ok\":true,\"building1\":";
+    jsonBuilding(out, result.building1);
+    out << ",\"building2\":";
+    jsonBuilding(out, result.building2);
+    out << ",\"profile\":" << jsonString(profileName(result.profile))
+        << ",\"reachable\":" << (result.reachable ? "true" : "false");
+
+    if (result.reachable){
+        out << ",\"cost\":" << result.cost << ",\"path\":";
+        jsonPath(out, result.distance, result.path);
+    }
+
+    out << "}";
+    return out.str();
+}
+
+static string isochroneReply(const MapData& data, const IsochroneResult& result, double minutes){
+
+    if (!result.buildingFound){
+        return jsonError("building not found");
+    }
+
+    ostringstream out;
+    out << setprecision(10);
+
+    out << "{\"ok\":true,\"building\":";
+    jsonBuilding(out, result.building);
+    out << ",\"minutes\":" << minutes << ",\"distance\":" << result.maxDistance
+        << ",\"nodes\":" << result.nodes.size() << ",\"buildings\":[";
+
+    for (size_t i = 0; i < result.buildings.size(); i++){
+        out << (i ? "," : "") << "{\"building\":";
+        jsonBuilding(out, data.Buildings[result.buildings[i]]);
+        out << ",\"distance\":" << result.buildingDistances[i] << "}";
+    }
+
+    out << "],\"boundary\":[";
+
+    for (size_t i = 0; i < result.boundary.size(); i++){
+        out << (i ? "," : "") << "[" << result.boundary[i].first << "," << result.boundary[i].second << "]";
+    }
+
+    out << "]}";
+    return out.str();
+}
+
+static string routesReply(const RoutesResult& result){
+
+    if (!result.build1Found || !result.build2Found){
+        return jsonNotFound(result.build1Found);
+    }
+
+    ostringstream out;
+    out << setprecision(10);
+
+    out << "{\"ok\":true,\"building1\":";
+    jsonBuilding(out, result.building1);
+    out << ",\"building2\":";
+    jsonBuilding(out, result.building2);
+    out << ",\"routes\":[";
+
+    for (size_t i = 0; i < result.routes.size(); i++){
+        out << (i ? "," : "");
+        jsonPath(out, result.routes[i].distance, result.routes[i].path);
+    }
+
+    out << "]}";
+    return out.str();
+}
+
+static string findReply(const MapData& data, const string& query){
+
+    vector<BuildingMatch> matches;
+    data.BuildingNames.fuzzyFind(query, FindResults, matches);
+
+    ostringstream out;
+    out << setprecision(10);
+
+    out << "{\"ok\":true,\"matches\":[";
+
+    for (size_t i = 0; i < matches.size(); i++){
+        out << (i ? "," : "") << "{\"building\":";
+        jsonBuilding(out, data.Buildings[matches[i].building]);
+        out << ",\"edits\":" << matches[i].edits << "}";
+    }
+
+    out << "]}";
+    return out.str();
+}
+
+static string completeReply(const MapData& data, const string& prefix){
+
+    vector<int> suggestions;
+    data.BuildingNames.complete(prefix, CompleteResults, suggestions);
+
+    ostringstream out;
+    out << setprecision(10);
+
+    out << "{\"ok\":true,\"completions\":[";
+
+    for (size_t i = 0; i < suggestions.size(); i++){
+        out << (i ? "," : "");
+        jsonBuilding(out, data.Buildings[suggestions[i]]);
+    }
+
+    out << "]}";
+    return out.str();
+}
+
+static string statsReply(QueryEngine& engine){
+
+    ostringstream out;
+    out << setprecision(6);
+
+    shared_ptr<const ServingMap> map = engine.current();
+
+    out << "{\"ok\":true,\"workers\":" << engine.numWorkers() << ",\"mapVersion\":" << map->version << ",\"cache\":";
+
+    if (!map->cache){
+        out << "null";
+    }
+    else{
+        CacheStats stats = map->cache->stats();
+        out << "{\"hits\":" << stats.hits
+            << ",\"misses\":" << stats.misses
+            << ",\"hitRate\":" << stats.hitRate()
+            << ",\"insertions\":" << stats.insertions
+            << ",\"evictions\":" << stats.evictions
+            << ",\"entries\":" << stats.entries
+            << ",\"bytes\":" << stats.bytes
+            << ",\"maxEntries\":" << stats.maxEntries
+            << ",\"maxBytes\":" << stats.maxBytes << "}";
+    }
+
+    if (engine.tracer()){
+        out << ",\"latency\":";
+        engine.tracer()->writeLatencyJson(out);
+    }
+
+    // counters of the instrumented build
+    StatsSnapshot instrumentation = statsSnapshot();
+    if (instrumentation.enabled){
+        out << ",\"instrumentation\":";
+        writeStatsJson(out, instrumentation);
+    }
+
+    out << "}";
+    return out.str();
+}
+
+/*function parses one request line and queues the work for it
+Takes 3 parameters:
+    1. line: the request, without its newline
+    2. conn: the connection the request came from
+    3. engine: the worker pool
+No returns*/
+static void handleRequest(const string& line, Connection& conn, QueryEngine& engine){
+
+    if (line == "QUIT"){
+        conn.closing = true;
+        return;
+    }
+
+    auto reply = make_shared<Reply>();
+    conn.pending.push_back(reply);
+
+    if (line == "STATS"){
+        reply->text = statsReply(engine);
+        reply->done = true;
+        return;
+    }
+
+    size_t space = line.find(' ');
+    string command = line.substr(0, space);
+    string args = (space == string::npos) ? "" : line.substr(space + 1);
+    size_t tab = args.find('\t');
+
+    // completions take microseconds, less than handing them to a worker
+    if (command == "COMPLETE"){
+        reply->text = completeReply(*engine.current()->data, args);
+        reply->done = true;
+        return;
+    }
+
+    if (command == "FIND"){
+        engine.post([reply, args](const ServingMap& map, SearchWorkspace&){
+            reply->text = findReply(*map.data, args);
+            reply->done = true;
+
+            char c = 0;
+            if (write(wakeupWrite, &c, 1) < 0) { /* pipe full: the loop is already due to wake */ }
+        });
+        return;
+    }
+
+    if (command == "ISOCHRONE" && tab != string::npos){
+        string building = args.substr(0, tab);
+
+        const char* field = args.c_str() + tab + 1;
+        char* end;
+        double minutes = strtod(field, &end);
+
+        if (end == field || *end != '\0' || !isfinite(minutes) || minutes <= 0){
+            reply->text = jsonError("bad request: ISOCHRONE minutes must be a positive number");
+            reply->done = true;
+            return;
+        }
+
+        engine.post([reply, building, minutes](const ServingMap& map, SearchWorkspace& ws){
+            IsochroneResult result = findIsochrone(*map.data, building, minutes * WalkingMilesPerMinute, ws);
+            reply->text = isochroneReply(*map.data, result, minutes);
+            reply->done = true;
+
+            char c = 0;
+            if (write(wakeupWrite, &c, 1) < 0) { /* pipe full: the loop is already due to wake */ }
+        });
+        return;
+    }
+
+    if (command == "ROUTES" && tab != string::npos){
+        string building1 = args.substr(0, tab);
+        string building2 = args.substr(tab + 1);
+
+        // an optional third field asks for other than the default number of routes
+        RouteOptions options;
+        size_t kTab = building2.find('\t');
+        if (kTab != string::npos){
+            options.k = max(1, min(MaxRoutes, atoi(building2.c_str() + kTab + 1)));
+            building2.resize(kTab);
+        }
+
+        engine.post([reply, building1, building2, options](const ServingMap& map, SearchWorkspace& ws){
+            reply->text = routesReply(findBuildingRoutes(*map.data, building1, building2, options, ws));
+            reply->done = true;
+
+            char c = 0;
+            if (write(wakeupWrite, &c, 1) < 0) { /* pipe full: the loop is already due to wake */ }
+        });
+        return;
+    }
+
+    if ((command != "MEET" && command != "PATH") || tab == string::npos){
+        reply->text = jsonError("bad request: expected MEET, PATH or ROUTES <building><TAB><building>, ISOCHRONE <building><TAB><minutes>,"
+                                " FIND <name> or COMPLETE <prefix>");
+        reply->done = true;
+        return;
+    }
+
+    string person1Building = args.substr(0, tab);
+    string person2Building = args.substr(tab + 1);
+    bool meet = (command == "MEET");
+
+    // a path may name the cost profile it minimizes
+    CostProfile profile = CostProfile::Distance;
+    size_t profileTab = person2Building.find('\t');
+    if (!meet && profileTab != string::npos){
+        if (!parseCostProfile(person2Building.substr(profileTab + 1), profile)){
+            reply->text = jsonError("bad request: unknown profile, expected distance, time, avoid-stairs or accessible");
+            reply->done = true;
+            return;
+        }
+        person2Building.resize(profileTab);
+    }
+
+    engine.post([&engine, reply, meet, person1Building, person2Building, profile](const ServingMap& map, SearchWorkspace& ws){
+
+        if (meet){
+            reply->text = meetingReply(engine.meet(map, person1Building, person2Building, ws));
+        }
+        else{
+            reply->text = pathReply(findBuildingPath(*map.data, person1Building, person2Building, ws, profile));
+        }
+
+        reply->done = true;
+
+        char c = 0;
+        if (write(wakeupWrite, &c, 1) < 0) { /* pipe full: the loop is already due to wake */ }
+    });
+}
+
+/*function moves finished replies, in request order, into a connection's output buffer
+Takes 1 parameter:
+    conn: the connection
+No returns*/
+static void collectReplies(Connection& conn){
+
+    while (!conn.pending.empty() && conn.pending.front()->done){
+        conn.outBuf += conn.pending.front()->text;
+        conn.outBuf += '\n';
+        conn.pending.pop_front();
+    }
+}
+
+/*function tells whether a connection has as many replies outstanding or waiting to be
+written as it may, so no more of its requests are taken until it reads them
+Takes 1 parameter:
+    conn: the connection
+Returns true if its requests should wait*/
+static bool backedUp(const Connection& conn){
+    return conn.pending.size() >= MaxPendingReplies || conn.outBuf.size() >= MaxOutBytes;
+}
+
+/*function handles the complete lines in a connection's input buffer, stopping early if
+the connection backs up; the lines left are handled once it has drained
+Takes 2 parameters:
+    1. conn: the connection
+    2. engine: the worker pool
+No returns*/
+static void handleLines(Connection& conn, QueryEngine& engine){
+
+    size_t start = 0, end;
+    while (!conn.closing && !backedUp(conn) && (end = conn.inBuf.find('\n', start)) != string::npos){
+
+        if (end - start > MaxLineBytes) break;
+
+        string line = conn.inBuf.substr(start, end - start);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        handleRequest(line, conn, engine);
+        start = end + 1;
+    }
+    conn.inBuf.erase(0, start);
+
+    // the first line left is too long, whether it is complete or still arriving
+    size_t first = conn.inBuf.find('\n');
+    if (!conn.closing && (first == string::npos ? conn.inBuf.size() : first) > MaxLineBytes){
+        auto reply = make_shared<Reply>();
+        reply->text = jsonError("request line longer than " + to_string(MaxLineBytes) + " bytes");
+        reply->done = true;
+        conn.pending.push_back(reply);
+
+        conn.inBuf.clear();
+        conn.closing = true;
+    }
+}
+
+/*function reads what is available on a connection and handles every complete line
+Returns false when the client has hung up*/
+static bool readConnection(Connection& conn, QueryEngine& engine){
+
+    char buf[4096];
+    bool hungUp = false;
+
+    // lines are handled as each chunk arrives, so the buffer never holds more
+    // than one read past the line limit; a backed-up connection is not read
+    while (!conn.closing && !backedUp(conn)){
+        ssize_t n = read(conn.fd, buf, sizeof(buf));
+
+        if (n > 0){
+            conn.inBuf.append(buf, n);
+            handleLines(conn, engine);
+        }
+        else if (n == 0){
+            hungUp = true;
+            break;
+        }
+        else if (errno == EINTR){
+            continue;
+        }
+        else{
+            break; // EAGAIN: nothing more for now
+        }
+    }
+
+    return !hungUp;
+}
+
+/*function writes as much of the output buffer as the socket takes
+Returns false if the connection failed*/
+static bool writeConnection(Connection& conn){
+
+    while (!conn.outBuf.empty()){
+        ssize_t n = send(conn.fd, conn.outBuf.data(), conn.outBuf.size(), MSG_NOSIGNAL);
+
+        if (n > 0){
+            conn.outBuf.erase(0, n);
+        }
+        else if (n < 0 && errno == EINTR){
+            continue;
+        }
+        else{
+            return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+    }
+
+    return true;
+}
+
+/*function runs the server until it receives SIGINT or SIGTERM
+Takes 5 parameters:
+    1. data: the loaded map
+    2. source: where the map was loaded from; it is reloaded on change if source.watchInterval is set
+    3. socketPath: the path of the Unix domain socket to listen on
+    4. numThreads: the number of worker threads, 0 for one per hardware thread
+    5. cacheEntries: the size of the result cache, 0 for no cache
+    6. tracer: if not null, meeting queries are traced into it and STATS reports their latency
+Returns false if the socket could not be set up*/
+bool runServer(shared_ptr<const MapData> data, const MapSource& source, const string& socketPath,
+               unsigned numThreads, size_t cacheEntries, QueryTracer* tracer){
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (socketPath.size() >= sizeof(addr.sun_path)){
+        cout << "**Error: socket path '" << socketPath << "' is too long." << endl;
+        return false;
+    }
+    strcpy(addr.sun_path, socketPath.c_str());
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socketPath.c_str());
+
+    if (listenFd < 0 || bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, 128) < 0){
+        cout << "**Error: unable to listen on '" << socketPath << "': " << strerror(errno) << endl;
+        if (listenFd >= 0) close(listenFd);
+        return false;
+    }
+    setNonBlocking(listenFd);
+
+    // workers and the signal handler wake the loop by writing a byte to this pipe
+    int wakeup[2];
+    if (pipe(wakeup) < 0){
+        cout << "**Error: unable to create pipe: " << strerror(errno) << endl;
+        close(listenFd);
+        return false;
+    }
+    setNonBlocking(wakeup[0]);
+    setNonBlocking(wakeup[1]);
+    wakeupWrite = wakeup[1];
+
+    stopRequested = 0;
+    signal(SIGINT, onStopSignal);
+    signal(SIGTERM, onStopSignal);
+
+    map<int, Connection> connections;
+
+    {
+        QueryEngine engine(data, numThreads, cacheEntries);
+        engine.setTracer(tracer);
+        data.reset(); // the engine holds the map from here on, so a reload can free it
+
+        unique_ptr<MapWatcher> watcher;
+        if (source.watchInterval.count() > 0){
+            watcher = make_unique<MapWatcher>(engine, source);
+        }
+
+        cout << "Listening on " << socketPath << " with " << engine.numWorkers() << " worker threads" << endl;
+
+        vector<pollfd> fds;
+
+        while (!stopRequested){
+
+            fds.clear();
+            fds.push_back({wakeup[0], POLLIN, 0});
+            fds.push_back({listenFd, POLLIN, 0});
+
+            for (auto& pair : connections){
+                const Connection& conn = pair.second;
+                short events = (conn.closing || conn.hungUp || backedUp(conn)) ? 0 : POLLIN;
+                if (!conn.outBuf.empty()) events |= POLLOUT;
+
+                // connections that are not read and are waiting on workers are left out, or
+                // their hangup would spin the loop
+                if (events) fds.push_back({pair.first, events, 0});
+            }
+
+            if (poll(fds.data(), fds.size(), -1) < 0){
+                if (errno == EINTR) continue;
+                break;
+            }
+
+            // drain the wakeup pipe; finished replies are collected below
+            if (fds[0].revents & POLLIN){
+                char buf[256];
+                while (read(wakeup[0], buf, sizeof(buf)) > 0) {}
+            }
+
+            // accept new clients
+            if (fds[1].revents & POLLIN){
+                int clientFd;
+                while ((clientFd = accept(listenFd, nullptr, nullptr)) >= 0){
+                    setNonBlocking(clientFd);
+                    connections[clientFd].fd = clientFd;
+                }
+            }
+
+            for (size_t i = 2; i < fds.size(); i++){
+
+                Connection& conn = connections[fds[i].fd];
+
+                // a client that stops sending still gets the replies to what it sent
+                if ((fds[i].revents & (POLLIN | POLLHUP)) && !conn.closing && !conn.hungUp){
+                    if (!readConnection(conn, engine)) conn.hungUp = true;
+                }
+
+                if (fds[i].revents & POLLERR){
+                    conn.closing = true;
+                    conn.outBuf.clear();
+                    conn.pending.clear(); // workers still hold their Reply, so dropping it is safe
+                }
+            }
+
+            // flush replies, and close connections with nothing left to send
+            for (auto it = connections.begin(); it != connections.end(); ){
+
+                Connection& conn = it->second;
+                collectReplies(conn);
+
+                bool ok = writeConnection(conn);
+
+                // lines held back while the connection was backed up are taken once it drains
+                while (ok && !conn.closing && !backedUp(conn) && conn.inBuf.find('\n') != string::npos){
+                    handleLines(conn, engine);
+                    collectReplies(conn);
+                    ok = writeConnection(conn);
+                }
+
+                bool finished = conn.closing || (conn.hungUp && conn.inBuf.find('\n') == string::npos);
+
+                if (!ok || (finished && conn.pending.empty() && conn.outBuf.empty())){
+                    close(conn.fd);
+                    it = connections.erase(it);
+                }
+                else{
+                    ++it;
+                }
+            }
+        }
+
+        cout << "Shutting down..." << endl;
+
+        watcher.reset();
+    } // engine finishes queued queries and joins its workers here
+
+    for (auto& pair : connections){
+        close(pair.first);
+    }
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+
+    close(listenFd);
+    close(wakeup[0]);
+    close(wakeup[1]);
+    wakeupWrite = -1;
+    unlink(socketPath.c_str());
+
+    return true;
+}
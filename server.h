@@ -0,0 +1,38 @@
+// server.h
+//
+// Long-running server mode: loads the map once, then answers queries sent over a
+// Unix domain socket. One thread runs a poll() event loop over the connections
+// and hands each query to the QueryEngine's worker pool.
+//
+// Protocol: one request per line, one JSON object per line in reply, replies
+// in the same order as the requests on each connection. A line longer than 64 KiB
+// is answered with an error and the connection is closed. A client with 256
+// replies outstanding, or 1 MiB of them unread, is not read from until it has
+// caught up.
+//
+//    MEET <person 1's building>\t<person 2's building>   meeting point query
+//    PATH <building 1>\t<building 2>[\t<profile>]        cheapest path between two buildings, the
+//                                                        shortest unless profile is time, avoid-stairs
+//                                                        or accessible
+//    ROUTES <building 1>\t<building 2>[\t<k>]            up to k alternative routes, shortest first
+//    ISOCHRONE <building>\t<minutes>                    buildings and area within a walk of minutes
+//    FIND <name>                                         buildings with the closest names
+//    COMPLETE <prefix>                                   buildings to suggest as a name is typed
+//    STATS                                               worker, map version, result cache and latency counters
+//    QUIT                                                closes the connection
+//
+// Replies always carry "ok"; failed requests carry "error" instead of a result.
+
+#pragma once
+
+#include <string>
+#include <memory>
+
+#include "mapdata.h"
+#include "reload.h"
+#include "trace.h"
+
+using namespace std;
+
+bool runServer(shared_ptr<const MapData> data, const MapSource& source, const string& socketPath,
+               unsigned numThreads, size_t cacheEntries, QueryTracer* tracer = nullptr);
@@ -0,0 +1,68 @@
+// simd.h
+//
+// Minimal portable SIMD layer for doubles. SimdDouble wraps the widest vector the
+// compiler is targeting: AVX2 (4 lanes, build with -mavx2), SSE2 (2 lanes, the
+// x86-64 default) or a plain double (1 lane) everywhere else. Only the operations
+// the distance kernels need are provided.
+//
+// Each operation is a single IEEE multiply or add per lane, so a kernel written
+// with SimdDouble rounds exactly like the same expression written with doubles,
+// as long as the compiler is not contracting multiply-adds into FMAs.
+
+#pragma once
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+
+struct SimdDouble
+{
+  static constexpr int Width = 4;
+  __m256d v;
+
+  static SimdDouble load(const double* p) { return {_mm256_loadu_pd(p)}; }
+  static SimdDouble set1(double x) { return {_mm256_set1_pd(x)}; }
+  void store(double* p) const { _mm256_storeu_pd(p, v); }
+
+  friend SimdDouble operator+(SimdDouble a, SimdDouble b) { return {_mm256_add_pd(a.v, b.v)}; }
+  friend SimdDouble operator-(SimdDouble a, SimdDouble b) { return {_mm256_sub_pd(a.v, b.v)}; }
+  friend SimdDouble operator*(SimdDouble a, SimdDouble b) { return {_mm256_mul_pd(a.v, b.v)}; }
+};
+
+#elif defined(__SSE2__)
+
+struct SimdDouble
+{
+  static constexpr int Width = 2;
+  __m128d v;
+
+  static SimdDouble load(const double* p) { return {_mm_loadu_pd(p)}; }
+  static SimdDouble set1(double x) { return {_mm_set1_pd(x)}; }
+  void store(double* p) const { _mm_storeu_pd(p, v); }
+
+  friend SimdDouble operator+(SimdDouble a, SimdDouble b) { return {_mm_add_pd(a.v, b.v)}; }
+  friend SimdDouble operator-(SimdDouble a, SimdDouble b) { return {_mm_sub_pd(a.v, b.v)}; }
+  friend SimdDouble operator*(SimdDouble a, SimdDouble b) { return {_mm_mul_pd(a.v, b.v)}; }
+};
+
+#else
+
+struct SimdDouble
+{
+  static constexpr int Width = 1;
+  double v;
+
+  static SimdDouble load(const double* p) { return {*p}; }
+  static SimdDouble set1(double x) { return {x}; }
+  void store(double* p) const { *p = v; }
+
+  friend SimdDouble operator+(SimdDouble a, SimdDouble b) { return {a.v + b.v}; }
+  friend SimdDouble operator-(SimdDouble a, SimdDouble b) { return {a.v - b.v}; }
+  friend SimdDouble operator*(SimdDouble a, SimdDouble b) { return {a.v * b.v}; }
+};
+
+#endif
@@ -0,0 +1,164 @@
+// spt.cpp
+//
+// Precomputation and lookups of the per-building shortest-path trees.
+
+#include <thread>
+#include <limits>
+#include <algorithm>
+#include <cassert>
+
+#include "spt.h"
+#include "mapdata.h"
+#include "query.h"
+
+using namespace std;
+
+/*function copies the result of a search into a compact tree
+Takes 3 parameters:
+    1. G: the graph that was searched
+    2. ws: the workspace holding the search results
+    3. tree: the tree to fill; its root is already set
+No returns*/
+static void compactTree(const SearchGraph& G, const SearchWorkspace& ws, ShortestPathTree& tree){
+
+    int n = G.numVertices();
+    tree.distance.assign(n, numeric_limits<float>::infinity());
+    tree.parentSlot.assign(n, ShortestPathTree::NoParent);
+
+    for (int v = 0; v < n; v++){
+
+        double dist = ws.distanceTo(v);
+        if (dist == INF) continue;
+
+        tree.distance[v] = static_cast<float>(dist);
+
+        int parent = ws.predecessorOf(v);
+        if (parent == -1) continue;
+
+        // the parent is one of v's own neighbors, since footway edges go both ways
+        for (int e = G.offsets[v]; e < G.offsets[v + 1]; e++){
+            if (G.targets[e] == parent){
+                assert(e - G.offsets[v] < ShortestPathTree::NoParent);
+                tree.parentSlot[v] = static_cast<uint16_t>(e - G.offsets[v]);
+                break;
+            }
+        }
+
+        assert(tree.parentSlot[v] != ShortestPathTree::NoParent);
+    }
+}
+
+void BuildingTrees::build(const MapData& data, unsigned numThreads){
+
+    search = &data.Search;
+    buildingIndex.clear();
+    accessNodes.clear();
+    treeOf.clear();
+    trees.clear();
+
+    if (data.FootwayNodeIds.empty()) return;
+
+    // one tree per distinct access node, since neighboring buildings often share one
+    unordered_map<int, int> treeOfNode;
+
+    for (int b = 0; b < (int)data.Buildings.size(); b++){
+
+        const BuildingInfo& building = data.Buildings[b];
+        buildingIndex.emplace(building.Coords.ID, b);
+
+        int node = data.BuildingAccess[b];
+        accessNodes.push_back(node);
+
+        auto found = treeOfNode.find(node);
+        if (found == treeOfNode.end()){
+            found = treeOfNode.emplace(node, (int)trees.size()).first;
+            trees.emplace_back();
+            trees.back().root = node;
+        }
+
+        treeOf.push_back(found->second);
+    }
+
+    if (numThreads == 0){
+        numThreads = max(1u, thread::hardware_concurrency());
+    }
+    numThreads = min<unsigned>(numThreads, trees.size());
+
+    // trees are independent, so each thread takes every numThreads'th one
+    vector<thread> workers;
+    for (unsigned t = 0; t < numThreads; t++){
+        workers.emplace_back([this, &data, t, numThreads](){
+            SearchWorkspace ws;
+
+            for (size_t i = t; i < trees.size(); i += numThreads){
+                dijkstra(trees[i].root, data.Search, ws);
+                compactTree(data.Search, ws, trees[i]);
+            }
+        });
+    }
+
+    for (thread& worker : workers){
+        worker.join();
+    }
+}
+
+size_t BuildingTrees::bytes() const {
+
+    size_t total = accessNodes.capacity() * sizeof(int) + treeOf.capacity() * sizeof(int)
+                 + trees.capacity() * sizeof(ShortestPathTree);
+
+    for (const ShortestPathTree& tree : trees){
+        total += tree.distance.capacity() * sizeof(float) + tree.parentSlot.capacity() * sizeof(uint16_t);
+    }
+
+    return total;
+}
+
+int BuildingTrees::indexOf(const BuildingInfo& building) const {
+
+    auto found = buildingIndex.find(building.Coords.ID);
+    return found == buildingIndex.end() ? -1 : found->second;
+}
+
+double BuildingTrees::distanceBetween(int building1, int building2) const {
+
+    const ShortestPathTree& tree = treeFor(building1);
+    int destination = accessNodes[building2];
+
+    return tree.reaches(destination) ? tree.distance[destination] : INF;
+}
+
+bool BuildingTrees::buildPath(const ShortestPathTree& tree, int destination,
+                              vector<long long>& path, double& totDistance) const {
+
+    path.clear();
+    totDistance = INF;
+
+    if (!tree.reaches(destination)) return false;
+
+    vector<int> chain;
+    for (int v = destination; v != tree.root; ){
+        chain.push_back(v);
+        v = search->targets[search->offsets[v] + tree.parentSlot[v]];
+    }
+    chain.push_back(tree.root);
+    reverse(chain.begin(), chain.end());
+
+    // sums the edge weights in the same order dijkstra() relaxed them
+    totDistance = 0;
+    for (size_t i = 0; i < chain.size(); i++){
+
+        path.push_back(search->vertexIds[chain[i]]);
+        if (i == 0) continue;
+
+        int from = chain[i - 1], to = chain[i];
+        for (int e = search->offsets[from]; e < search->offsets[from + 1]; e++){
+            if (search->targets[e] == to){
+                totDistance += search->weights[e];
+                break;
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,90 @@
+// spt.h
+//
+// Optional precomputed shortest-path trees, one per building. Each building is
+// given an access node (its nearest footway node) and a full Dijkstra search is
+// run from every access node once, after loading. A building-to-building distance
+// is then a table lookup, and a path is a walk up the parent chain.
+//
+// Trees are stored compactly: a float distance and a 16-bit parent slot per
+// vertex, 6 bytes per vertex per distinct access node. The parent slot is the
+// position of the parent among the vertex's own edges in the SearchGraph, which
+// works because every footway edge is added in both directions.
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "osm.h"
+#include "search.h"
+
+using namespace std;
+
+struct MapData;
+
+//
+// ShortestPathTree
+//
+// The result of one search. distance is INFINITY for unreachable vertices, and
+// parentSlot is NoParent for the root and unreachable vertices.
+//
+struct ShortestPathTree
+{
+  static constexpr uint16_t NoParent = 0xFFFF;
+
+  int root = -1;
+  vector<float> distance;
+  vector<uint16_t> parentSlot;
+
+  bool reaches(int v) const { return parentSlot[v] != NoParent || v == root; }
+};
+
+class BuildingTrees {
+    private:
+
+        const SearchGraph* search = nullptr;
+        unordered_map<long long, int> buildingIndex; // building (way) ID -> position in Buildings
+        vector<int> accessNodes;                     // per building, a dense vertex index
+        vector<int> treeOf;                          // per building, an index into trees
+        vector<ShortestPathTree> trees;              // one per distinct access node
+
+    public:
+
+        //
+        // build
+        //
+        // Finds every building's access node and precomputes the trees, using
+        // numThreads threads (0 for one per hardware thread).
+        //
+        void build(const MapData& data, unsigned numThreads = 0);
+
+        bool ready() const { return !trees.empty(); }
+        int numTrees() const { return static_cast<int>(trees.size()); }
+        size_t bytes() const;
+
+        // returns the position of a building in Buildings, or -1 if it is unknown
+        int indexOf(const BuildingInfo& building) const;
+
+        int accessNode(int building) const { return accessNodes[building]; }
+        const ShortestPathTree& treeFor(int building) const { return trees[treeOf[building]]; }
+
+        //
+        // distanceBetween
+        //
+        // Returns the walking distance between two buildings' access nodes, INF
+        // if there is no path. Lookups are single precision.
+        //
+        double distanceBetween(int building1, int building2) const;
+
+        //
+        // buildPath
+        //
+        // Walks a tree's parent chain to build the path from its root to the
+        // destination vertex. The distance is re-summed from the double precision
+        // edge weights, so it matches what dijkstra() computes exactly.
+        // Returns false if the destination is unreachable.
+        //
+        bool buildPath(const ShortestPathTree& tree, int destination,
+                       vector<long long>& path, double& totDistance) const;
+};
@@ -0,0 +1,160 @@
+// stats.cpp
+//
+// Snapshots and output of the instrumentation counters.
+
+#include <iomanip>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+#include "stats.h"
+
+using namespace std;
+
+const char* counterName(Counter counter){
+
+    switch (counter){
+        case Counter::SettledVertices:   return "settledVertices";
+        case Counter::RelaxedEdges:      return "relaxedEdges";
+        case Counter::HeapPushes:        return "heapPushes";
+        case Counter::HeapPops:          return "heapPops";
+        case Counter::NearestCandidates: return "nearestCandidates";
+        default:                         return "?";
+    }
+}
+
+const char* phaseName(Phase phase){
+
+    switch (phase){
+        case Phase::LoadOpenStreetMap:       return "LoadOpenStreetMap";
+        case Phase::ReadMapNodes:            return "ReadMapNodes";
+        case Phase::ReadFootways:            return "ReadFootways";
+        case Phase::ReadUniversityBuildings: return "ReadUniversityBuildings";
+        case Phase::BuildGraph:              return "buildGraph";
+        case Phase::BuildIndexes:            return "buildIndexes";
+        case Phase::FindBuildings:           return "findBuildings";
+        case Phase::FindDestinationBuilding: return "findDestinationBuilding";
+        case Phase::FindNearestNodes:        return "findNearestNodes";
+        case Phase::Dijkstra:                return "dijkstra";
+        case Phase::BuildPath:               return "buildPath";
+        default:                             return "?";
+    }
+}
+
+#ifdef MAP_STATS
+
+// the threads counting now, and what finished threads counted
+static mutex registryLock;
+static vector<ThreadStats*> liveThreads;
+static long long finishedCounters[NumCounters];
+static long long finishedCalls[NumPhases];
+static long long finishedNs[NumPhases];
+
+ThreadStats::ThreadStats(){
+
+    lock_guard<mutex> guard(registryLock);
+    liveThreads.push_back(this);
+}
+
+ThreadStats::~ThreadStats(){
+
+    lock_guard<mutex> guard(registryLock);
+
+    for (int c = 0; c < NumCounters; c++) finishedCounters[c] += counters[c].load(memory_order_relaxed);
+    for (int p = 0; p < NumPhases; p++){
+        finishedCalls[p] += calls[p].load(memory_order_relaxed);
+        finishedNs[p] += ns[p].load(memory_order_relaxed);
+    }
+
+    liveThreads.erase(find(liveThreads.begin(), liveThreads.end(), this));
+}
+
+StatsSnapshot statsSnapshot(){
+
+    StatsSnapshot stats;
+    stats.enabled = true;
+
+    long long ns[NumPhases];
+
+    lock_guard<mutex> guard(registryLock);
+
+    for (int c = 0; c < NumCounters; c++) stats.counters[c] = finishedCounters[c];
+    for (int p = 0; p < NumPhases; p++){
+        stats.calls[p] = finishedCalls[p];
+        ns[p] = finishedNs[p];
+    }
+
+    for (const ThreadStats* thread : liveThreads){
+        for (int c = 0; c < NumCounters; c++) stats.counters[c] += thread->counters[c].load(memory_order_relaxed);
+        for (int p = 0; p < NumPhases; p++){
+            stats.calls[p] += thread->calls[p].load(memory_order_relaxed);
+            ns[p] += thread->ns[p].load(memory_order_relaxed);
+        }
+    }
+
+    for (int p = 0; p < NumPhases; p++) stats.ms[p] = ns[p] / 1e6;
+
+    return stats;
+}
+
+#else
+
+StatsSnapshot statsSnapshot(){
+    return StatsSnapshot();
+}
+
+#endif
+
+void printStats(ostream& out, const StatsSnapshot& stats){
+
+    if (!stats.enabled){
+        out << "Stats: not built in; rebuild with make build DEFINES=-DMAP_STATS" << endl;
+        return;
+    }
+
+    // the caller's stream is left formatted as it was given
+    ios::fmtflags flags = out.flags();
+    streamsize precision = out.precision();
+
+    out << "Stats:" << endl;
+    out << left << setw(26) << "  phase" << right << setw(10) << "calls" << setw(14) << "total ms"
+        << setw(14) << "mean us" << endl;
+
+    for (int p = 0; p < NumPhases; p++){
+        if (stats.calls[p] == 0) continue;
+
+        out << left << setw(26) << ("  " + string(phaseName(static_cast<Phase>(p)))) << right << setw(10) << stats.calls[p]
+            << fixed << setprecision(3) << setw(14) << stats.ms[p]
+            << setw(14) << stats.ms[p] * 1000 / stats.calls[p] << endl;
+    }
+
+    for (int c = 0; c < NumCounters; c++){
+        out << left << setw(26) << ("  " + string(counterName(static_cast<Counter>(c)))) << right << setw(10)
+            << stats.counters[c] << endl;
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void writeStatsJson(ostream& out, const StatsSnapshot& stats){
+
+    out << "{\"enabled\":" << (stats.enabled ? "true" : "false") << ",\"phases\":{";
+
+    bool first = true;
+    for (int p = 0; p < NumPhases; p++){
+        if (stats.calls[p] == 0) continue;
+
+        out << (first ? "" : ",") << "\"" << phaseName(static_cast<Phase>(p)) << "\":{\"calls\":" << stats.calls[p]
+            << ",\"ms\":" << stats.ms[p] << "}";
+        first = false;
+    }
+
+    out << "},\"counters\":{";
+
+    for (int c = 0; c < NumCounters; c++){
+        out << (c ? "," : "") << "\"" << counterName(static_cast<Counter>(c)) << "\":" << stats.counters[c];
+    }
+
+    out << "}}";
+}
@@ -0,0 +1,135 @@
+// stats.h
+//
+// Optional instrumentation: how long each load phase and query stage takes, and
+// how much work the searches do. It is compiled in with
+//
+//    make build DEFINES=-DMAP_STATS
+//
+// and otherwise STAT_TIMER and STAT_COUNT expand to nothing, so the normal build
+// does no extra work at all. When compiled in, each thread counts into its own
+// ThreadStats, with no locking or shared cache lines on the hot paths; a snapshot
+// adds up every thread's counts, including threads that have already finished.
+
+#pragma once
+
+#include <ostream>
+#include <atomic>
+#include <chrono>
+
+using namespace std;
+
+enum class Counter
+{
+  SettledVertices,    // vertices dijkstra() settled
+  RelaxedEdges,       // edges dijkstra() scanned from settled vertices
+  HeapPushes,
+  HeapPops,
+  NearestCandidates,  // footway nodes compared in nearest-node searches
+  NumCounters
+};
+
+enum class Phase
+{
+  LoadOpenStreetMap,
+  ReadMapNodes,
+  ReadFootways,
+  ReadUniversityBuildings,
+  BuildGraph,
+  BuildIndexes,
+  FindBuildings,
+  FindDestinationBuilding,
+  FindNearestNodes,
+  Dijkstra,
+  BuildPath,
+  NumPhases
+};
+
+const int NumCounters = static_cast<int>(Counter::NumCounters);
+const int NumPhases = static_cast<int>(Phase::NumPhases);
+
+const char* counterName(Counter counter);
+const char* phaseName(Phase phase);
+
+//
+// StatsSnapshot
+//
+// Totals over every thread at one moment. enabled is false when the program was
+// built without MAP_STATS, and everything else is then zero.
+//
+struct StatsSnapshot
+{
+  bool enabled = false;
+  long long counters[NumCounters] = {};
+  long long calls[NumPhases] = {};
+  double ms[NumPhases] = {};
+};
+
+StatsSnapshot statsSnapshot();
+
+// a table for people, and the same figures as one JSON object
+void printStats(ostream& out, const StatsSnapshot& stats);
+void writeStatsJson(ostream& out, const StatsSnapshot& stats);
+
+#ifdef MAP_STATS
+
+//
+// ThreadStats
+//
+// One thread's counts. Only the owning thread writes them, so updates are a plain
+// load and store; they are atomic only so that snapshots may read them meanwhile.
+//
+struct ThreadStats
+{
+  atomic<long long> counters[NumCounters] = {};
+  atomic<long long> calls[NumPhases] = {};
+  atomic<long long> ns[NumPhases] = {};
+
+  ThreadStats();   // registers, for snapshots
+  ~ThreadStats();  // adds the counts to the totals of finished threads
+
+  ThreadStats(const ThreadStats&) = delete;
+  ThreadStats& operator=(const ThreadStats&) = delete;
+};
+
+inline ThreadStats& threadStats(){
+    thread_local ThreadStats stats;
+    return stats;
+}
+
+inline void statAdd(atomic<long long>& value, long long n){
+    value.store(value.load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+//
+// StatTimer
+//
+// Adds the time from its construction to its destruction to a phase.
+//
+class StatTimer {
+    private:
+
+        Phase phase;
+        chrono::steady_clock::time_point start;
+
+    public:
+
+        explicit StatTimer(Phase phase) : phase(phase), start(chrono::steady_clock::now()) {}
+
+        ~StatTimer(){
+            ThreadStats& stats = threadStats();
+            statAdd(stats.calls[static_cast<int>(phase)], 1);
+            statAdd(stats.ns[static_cast<int>(phase)],
+                    chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+        }
+};
+
+// times the rest of the enclosing scope; one per scope
+#define STAT_TIMER(phase) StatTimer statTimer(phase)
+#define STAT_COUNT(counter, n) statAdd(threadStats().counters[static_cast<int>(counter)], (n))
+
+#else
+
+#define STAT_TIMER(phase) ((void)0)
+#define STAT_COUNT(counter, n) ((void)0)
+
+#endif
@@ -0,0 +1,251 @@
+// trace.cpp
+//
+// Latency histograms, and the recording and output of query traces.
+
+#include <iomanip>
+#include <cmath>
+#include <bit>
+#include <thread>
+
+#include "trace.h"
+
+using namespace std;
+
+const char* traceStageName(TraceStage stage){
+
+    switch (stage){
+        case TraceStage::FindBuildings:    return "findBuildings";
+        case TraceStage::CacheLookup:      return "cacheLookup";
+        case TraceStage::FindDestination:  return "findDestinationBuilding";
+        case TraceStage::FindNearestNodes: return "findNearestNodes";
+        case TraceStage::SearchPerson1:    return "searchPerson1";
+        case TraceStage::SearchPerson2:    return "searchPerson2";
+        case TraceStage::Query:            return "query";
+        default:                           return "?";
+    }
+}
+
+/*function finds the bucket a duration is counted in
+Takes 1 parameter:
+    ns: the duration, in nanoseconds
+Returns the index of the bucket*/
+int LatencyHistogram::bucketOf(long long ns){
+
+    if (ns < SubBuckets) return static_cast<int>(std::max(ns, 0LL));
+
+    // ns is in [2^k, 2^(k+1)), which is split into SubBuckets buckets
+    int k = 63 - countl_zero(static_cast<unsigned long long>(ns));
+    int shift = k - SubBits;
+
+    return SubBuckets * (shift + 1) + static_cast<int>((ns >> shift) - SubBuckets);
+}
+
+/*function finds the largest duration counted in a bucket
+Takes 1 parameter:
+    bucket: the index of the bucket
+Returns the duration, in nanoseconds*/
+long long LatencyHistogram::highestIn(int bucket){
+
+    if (bucket < SubBuckets) return bucket;
+
+    int shift = bucket / SubBuckets - 1;
+    long long low = static_cast<long long>(SubBuckets + bucket % SubBuckets) << shift;
+
+    return low + (1LL << shift) - 1;
+}
+
+void LatencyHistogram::record(long long ns){
+
+    counts[bucketOf(ns)].fetch_add(1, memory_order_relaxed);
+    total.fetch_add(1, memory_order_relaxed);
+    sumNs.fetch_add(ns, memory_order_relaxed);
+
+    long long seen = maxNs.load(memory_order_relaxed);
+    while (ns > seen && !maxNs.compare_exchange_weak(seen, ns, memory_order_relaxed)) {}
+}
+
+double LatencyHistogram::mean() const {
+
+    long long n = count();
+    return n ? static_cast<double>(sumNs.load(memory_order_relaxed)) / n : 0.0;
+}
+
+long long LatencyHistogram::percentile(double q) const {
+
+    long long n = count();
+    if (n == 0) return 0;
+
+    long long rank = std::max(1LL, static_cast<long long>(ceil(q * n)));
+    long long seen = 0;
+
+    for (int b = 0; b < NumBuckets; b++){
+        seen += counts[b].load(memory_order_relaxed);
+        if (seen >= rank) return std::min(highestIn(b), max());
+    }
+
+    return max();
+}
+
+QueryTracer::QueryTracer(bool keepEvents) : keepEvents(keepEvents), epoch(chrono::steady_clock::now()) {}
+
+/*function gives each thread that records a trace a small number of its own, for the rows of the trace
+Returns the calling thread's number*/
+static int threadNumber(){
+
+    static atomic<int> numThreads{0};
+    thread_local int number = numThreads.fetch_add(1) + 1;
+    return number;
+}
+
+void QueryTracer::record(QueryTrace& trace){
+
+    trace.durationNs = trace.sinceStart(chrono::steady_clock::now());
+    trace.spans.push_back(TraceSpan{TraceStage::Query, 0, 0, trace.durationNs});
+
+    for (const TraceSpan& span : trace.spans){
+        stages[static_cast<int>(span.stage)].record(span.durationNs);
+    }
+
+    attemptCounts[min(trace.attempts, MaxAttempts)].fetch_add(1, memory_order_relaxed);
+
+    if (!keepEvents) return;
+
+    // event times are kept from the tracer's start, so every query shares one time line
+    long long offset = chrono::duration_cast<chrono::nanoseconds>(trace.start - epoch).count();
+    int thread = threadNumber();
+
+    lock_guard<mutex> guard(eventsLock);
+
+    int query = static_cast<int>(queries.size());
+    queries.push_back(pair(trace.person1Building, trace.person2Building));
+
+    for (TraceSpan span : trace.spans){
+        span.startNs += offset;
+        events.push_back(TraceEvent{span, thread, query});
+    }
+}
+
+void QueryTracer::printLatency(ostream& out) const {
+
+    ios::fmtflags flags = out.flags();
+    streamsize precision = out.precision();
+
+    out << "Latency (us):" << endl;
+    out << left << setw(26) << "  stage" << right << setw(10) << "count" << setw(10) << "p50"
+        << setw(10) << "p90" << setw(10) << "p99" << setw(10) << "max" << setw(10) << "mean" << endl;
+
+    out << fixed << setprecision(1);
+
+    for (int s = 0; s < NumTraceStages; s++){
+        const LatencyHistogram& h = stages[s];
+        if (h.count() == 0) continue;
+
+        out << left << setw(26) << ("  " + string(traceStageName(static_cast<TraceStage>(s)))) << right
+            << setw(10) << h.count()
+            << setw(10) << h.percentile(0.50) / 1e3
+            << setw(10) << h.percentile(0.90) / 1e3
+            << setw(10) << h.percentile(0.99) / 1e3
+            << setw(10) << h.max() / 1e3
+            << setw(10) << h.mean() / 1e3 << endl;
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+
+    out << "Attempts per query:";
+    for (int a = 0; a <= MaxAttempts; a++){
+        long long n = attemptCounts[a].load(memory_order_relaxed);
+        if (n) out << " " << a << (a == MaxAttempts ? "+" : "") << ": " << n;
+    }
+    out << endl;
+}
+
+void QueryTracer::writeLatencyJson(ostream& out) const {
+
+    out << "{\"stages\":{";
+
+    bool first = true;
+    for (int s = 0; s < NumTraceStages; s++){
+        const LatencyHistogram& h = stages[s];
+        if (h.count() == 0) continue;
+
+        out << (first ? "" : ",") << "\"" << traceStageName(static_cast<TraceStage>(s)) << "\":{\"count\":" << h.count()
+            << ",\"p50Us\":" << h.percentile(0.50) / 1e3
+            << ",\"p90Us\":" << h.percentile(0.90) / 1e3
+            << ",\"p99Us\":" << h.percentile(0.99) / 1e3
+            << ",\"maxUs\":" << h.max() / 1e3
+            << ",\"meanUs\":" << h.mean() / 1e3 << "}";
+        first = false;
+    }
+
+    out << "},\"attempts\":{";
+
+    first = true;
+    for (int a = 0; a <= MaxAttempts; a++){
+        long long n = attemptCounts[a].load(memory_order_relaxed);
+        if (n == 0) continue;
+
+        out << (first ? "" : ",") << "\"" << a << (a == MaxAttempts ? "+" : "") << "\":" << n;
+        first = false;
+    }
+
+    out << "}}";
+}
+
+/*function writes a string as a JSON string literal
+Takes 2 parameters:
+    1. out: the stream to write to
+    2. s: the string
+No returns*/
+static void writeJsonString(ostream& out, const string& s){
+
+    out << '"';
+    for (char c : s){
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20) out << "\\u" << hex << setw(4) << setfill('0') << int(c) << dec << setfill(' ');
+        else out << c;
+    }
+    out << '"';
+}
+
+void QueryTracer::writeTraceJson(ostream& out){
+
+    lock_guard<mutex> guard(eventsLock);
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    streamsize precision = out.precision();
+    out << fixed << setprecision(3);
+
+    for (size_t i = 0; i < events.size(); i++){
+        const TraceEvent& event = events[i];
+        const pair<string, string>& query = queries[event.query];
+
+        out << (i ? ",\n" : "\n") << "{\"name\":\"" << traceStageName(event.span.stage) << "\",\"cat\":\"query\",\"ph\":\"X\""
+            << ",\"ts\":" << event.span.startNs / 1e3 << ",\"dur\":" << event.span.durationNs / 1e3
+            << ",\"pid\":1,\"tid\":" << event.thread << ",\"args\":{\"query\":" << event.query + 1
+            << ",\"attempt\":" << event.span.attempt << ",\"person1\":";
+        writeJsonString(out, query.first);
+        out << ",\"person2\":";
+        writeJsonString(out, query.second);
+        out << "}}";
+    }
+
+    out << "\n]}";
+    out << defaultfloat << setprecision(precision);
+}
+
+void printQueryTrace(ostream& out, const QueryTrace& trace){
+
+    out << "Trace: " << trace.durationNs / 1e3 << " us, " << trace.attempts << " attempt"
+        << (trace.attempts == 1 ? "" : "s") << endl;
+
+    for (const TraceSpan& span : trace.spans){
+        if (span.stage == TraceStage::Query) continue;
+
+        out << "  ";
+        if (span.attempt > 0) out << "attempt " << span.attempt << ": ";
+        out << traceStageName(span.stage) << " " << span.durationNs / 1e3 << " us"
+            << " (at " << span.startNs / 1e3 << " us)" << endl;
+    }
+}
@@ -0,0 +1,204 @@
+// trace.h
+//
+// Per-query tracing of the meeting point query. A QueryTrace records how long
+// each stage of one query took (the building lookup, and on every attempt of the
+// retry loop the destination choice, the nearest nodes and each person's search),
+// and a QueryTracer gathers finished traces from any number of threads into one
+// latency histogram per stage. It can also keep every span as a Chrome trace
+// event, to be opened in chrome://tracing or Perfetto.
+//
+// Unlike MAP_STATS this is always built in; a query costs nothing extra unless
+// it is given a QueryTrace.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+
+using namespace std;
+
+enum class TraceStage
+{
+  FindBuildings,
+  CacheLookup,
+  FindDestination,
+  FindNearestNodes,
+  SearchPerson1,  // dijkstra() from person 1, and the path to the destination
+  SearchPerson2,
+  Query,          // the whole query, from start to result
+  NumStages
+};
+
+const int NumTraceStages = static_cast<int>(TraceStage::NumStages);
+
+const char* traceStageName(TraceStage stage);
+
+//
+// LatencyHistogram
+//
+// Counts durations in nanoseconds, in the log-linear buckets of an HDR histogram:
+// values below 2^SubBits are counted exactly, and each power of two above that is
+// split into 2^SubBits buckets, so every reported percentile is within 1/32 of
+// the true value. Any thread may record at any time.
+//
+class LatencyHistogram {
+    private:
+
+        static constexpr int SubBits = 5;
+        static constexpr int SubBuckets = 1 << SubBits;
+        static constexpr int NumBuckets = SubBuckets * (64 - SubBits + 1);
+
+        atomic<long long> counts[NumBuckets] = {};
+        atomic<long long> total{0};
+        atomic<long long> sumNs{0};
+        atomic<long long> maxNs{0};
+
+        static int bucketOf(long long ns);
+        static long long highestIn(int bucket);
+
+    public:
+
+        void record(long long ns);
+
+        long long count() const { return total.load(memory_order_relaxed); }
+        long long max() const { return maxNs.load(memory_order_relaxed); }
+        double mean() const;
+
+        // the duration that fraction q (0 to 1) of the recorded durations are at or below
+        long long percentile(double q) const;
+};
+
+//
+// TraceSpan
+//
+// One timed stage of a query; attempt is the pass of the retry loop it belongs
+// to, 0 for stages before the loop. Times are from the start of the query.
+//
+struct TraceSpan
+{
+  TraceStage stage;
+  int attempt;
+  long long startNs;
+  long long durationNs;
+};
+
+//
+// QueryTrace
+//
+// The spans of one query, in the order they finished. The query starts when the
+// trace is constructed.
+//
+struct QueryTrace
+{
+  string person1Building;
+  string person2Building;
+  chrono::steady_clock::time_point start;
+  long long durationNs = 0;
+  int attempts = 0;
+  vector<TraceSpan> spans;
+
+  QueryTrace(const string& person1Building, const string& person2Building)
+    : person1Building(person1Building), person2Building(person2Building), start(chrono::steady_clock::now()) {}
+
+  long long sinceStart(chrono::steady_clock::time_point t) const {
+    return chrono::duration_cast<chrono::nanoseconds>(t - start).count();
+  }
+};
+
+//
+// StageTimer
+//
+// Adds a span for one stage to a trace, from its construction until stop() or
+// its destruction, whichever is first. Does nothing when the trace is null.
+//
+class StageTimer {
+    private:
+
+        QueryTrace* trace;
+        TraceStage stage;
+        chrono::steady_clock::time_point start;
+
+    public:
+
+        StageTimer(QueryTrace* trace, TraceStage stage) : trace(trace), stage(stage) {
+            if (trace) start = chrono::steady_clock::now();
+        }
+
+        ~StageTimer(){ stop(); }
+
+        StageTimer(const StageTimer&) = delete;
+        StageTimer& operator=(const StageTimer&) = delete;
+
+        void stop(){
+            if (!trace) return;
+
+            auto end = chrono::steady_clock::now();
+            trace->spans.push_back(TraceSpan{stage, trace->attempts, trace->sinceStart(start),
+                                             chrono::duration_cast<chrono::nanoseconds>(end - start).count()});
+            trace = nullptr;
+        }
+};
+
+//
+// QueryTracer
+//
+// Latency histograms of every stage over all the queries recorded, how many
+// attempts the queries needed, and, if keepEvents, every span as a trace event.
+//
+class QueryTracer {
+    private:
+
+        static constexpr int MaxAttempts = 8; // queries needing more are counted with this many
+
+        LatencyHistogram stages[NumTraceStages];
+        atomic<long long> attemptCounts[MaxAttempts + 1] = {};
+
+        struct TraceEvent
+        {
+          TraceSpan span;
+          int thread;
+          int query;
+        };
+
+        bool keepEvents;
+        chrono::steady_clock::time_point epoch;
+        mutex eventsLock;
+        vector<TraceEvent> events;
+        vector<pair<string, string>> queries; // events[i].query indexes this
+
+    public:
+
+        explicit QueryTracer(bool keepEvents = false);
+
+        QueryTracer(const QueryTracer&) = delete;
+        QueryTracer& operator=(const QueryTracer&) = delete;
+
+        //
+        // record
+        //
+        // Ends a query: adds its total time as a TraceStage::Query span, and every
+        // span to the histograms.
+        //
+        void record(QueryTrace& trace);
+
+        const LatencyHistogram& histogram(TraceStage stage) const { return stages[static_cast<int>(stage)]; }
+
+        // a table of percentiles per stage, and the same figures as one JSON object
+        void printLatency(ostream& out) const;
+        void writeLatencyJson(ostream& out) const;
+
+        //
+        // writeTraceJson
+        //
+        // Writes the kept events in Chrome's trace event format: one complete
+        // ("X") event per span, on a row per worker thread.
+        //
+        void writeTraceJson(ostream& out);
+};
+
+// one line per span of a finished query, for people
+void printQueryTrace(ostream& out, const QueryTrace& trace);
@@ -0,0 +1,136 @@
+// waytags.cpp
+//
+// The interned table of highway values behind a WayFilter.
+
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+
+#include "waytags.h"
+
+using namespace std;
+
+// FNV-1a over a NUL-terminated string
+static unsigned hashOf(const char* s){
+
+    unsigned h = 2166136261u;
+    for (; *s; s++){
+        h = (h ^ static_cast<unsigned char>(*s)) * 16777619u;
+    }
+
+    return h;
+}
+
+WayFilter::WayFilter(){
+
+    // https://wiki.openstreetmap.org/wiki/Key:highway, the ways meant for people on foot
+    accept("footway");
+    accept("path");
+    accept("pedestrian");
+    accept("living_street");
+    accept("corridor");
+    accept("track", 0.9);
+    accept("steps", 0.5);
+}
+
+WayFilter WayFilter::none(){
+
+    WayFilter filter;
+    filter.names.clear();
+    filter.speedFactors.clear();
+    filter.stairs.clear();
+    filter.hashes.clear();
+    filter.slots.clear();
+
+    return filter;
+}
+
+/*function lays the classes out again in a table at most half full
+No parameters
+No returns*/
+void WayFilter::_Rehash(){
+
+    size_t size = 8;
+    while (size < 2 * names.size()) size *= 2;
+
+    slots.assign(size, NotWalked);
+
+    for (int c = 0; c < numClasses(); c++){
+        size_t s = hashes[c] & (size - 1);
+        while (slots[s] != NotWalked) s = (s + 1) & (size - 1);
+        slots[s] = c;
+    }
+}
+
+int WayFilter::accept(const string& highway, double speedFactor){
+
+    int existing = classOf(highway.c_str());
+    if (existing != NotWalked){
+        speedFactors[existing] = speedFactor;
+        return existing;
+    }
+
+    names.push_back(highway);
+    speedFactors.push_back(speedFactor);
+    stairs.push_back(highway == "steps");
+    hashes.push_back(hashOf(highway.c_str()));
+    _Rehash();
+
+    return numClasses() - 1;
+}
+
+int WayFilter::classOf(const char* highway) const{
+
+    if (slots.empty()) return NotWalked;
+
+    unsigned h = hashOf(highway);
+    size_t mask = slots.size() - 1;
+
+    for (size_t s = h & mask; slots[s] != NotWalked; s = (s + 1) & mask){
+        int c = slots[s];
+        if (hashes[c] == h && names[c] == highway) return c;
+    }
+
+    return NotWalked;
+}
+
+string WayFilter::describe() const{
+
+    ostringstream out;
+
+    for (int c = 0; c < numClasses(); c++){
+        out << (c ? "," : "") << names[c];
+        if (speedFactors[c] != 1.0) out << ":" << speedFactors[c];
+    }
+
+    return out.str();
+}
+
+bool WayFilter::parse(const string& spec, WayFilter& filter){
+
+    WayFilter parsed = none();
+    stringstream entries(spec);
+    string entry;
+
+    while (getline(entries, entry, ',')){
+
+        size_t colon = entry.find(':');
+        string highway = entry.substr(0, colon);
+        double speedFactor = 1.0;
+
+        if (colon != string::npos){
+            const char* factor = entry.c_str() + colon + 1;
+            char* end;
+            speedFactor = strtod(factor, &end);
+            if (end == factor || *end != '\0' || speedFactor <= 0) return false;
+        }
+
+        if (highway.empty()) return false;
+        parsed.accept(highway, speedFactor);
+    }
+
+    if (parsed.numClasses() == 0) return false;
+
+    filter = parsed;
+    return true;
+}
@@ -0,0 +1,64 @@
+// waytags.h
+//
+// Which ways are walked. A WayFilter is a table of accepted highway values, each
+// one a way class with a speed factor: how fast the class is walked relative to a
+// footway, so stairs are slower than a sidewalk. The values are interned into a
+// small open-addressing table when the filter is built, so the reader finds a
+// way's class with one hash and at most a few compares instead of comparing the
+// value against every accepted string. Whether a class is stairs is settled then
+// too, so searches test a flag rather than the class's name.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//
+// WayFilter
+//
+// Classes are numbered in the order they were accepted; a way whose highway
+// value is not in the table has no class and is not read.
+//
+class WayFilter {
+    private:
+
+        vector<string>   names;
+        vector<double>   speedFactors;
+        vector<char>     stairs;  // per class, whether its highway value is "steps"
+        vector<unsigned> hashes;
+        vector<int>      slots;   // class per slot, -1 when empty; a power of 2 long
+
+        void _Rehash();
+
+    public:
+
+        static constexpr int NotWalked = -1;
+
+        // the default table: footways, sidewalks and other paths made for walking
+        WayFilter();
+
+        // an empty table, which accepts nothing
+        static WayFilter none();
+
+        // accepts ways with the given highway value, or changes its speed factor
+        // if it is already accepted; returns its class
+        int accept(const string& highway, double speedFactor = 1.0);
+
+        // the class of a highway value, or NotWalked
+        int classOf(const char* highway) const;
+
+        int numClasses() const { return static_cast<int>(names.size()); }
+        const string& nameOf(int wayClass) const { return names[wayClass]; }
+        double speedFactorOf(int wayClass) const { return speedFactors[wayClass]; }
+        bool isStairs(int wayClass) const { return stairs[wayClass]; }
+
+        // the table as parse() reads it
+        string describe() const;
+
+        // reads a table written as "value[:factor],value[:factor],...", for
+        // example "footway,path,steps:0.5"; returns false, leaving filter
+        // unchanged, if spec is malformed
+        static bool parse(const string& spec, WayFilter& filter);
+};